@@ -0,0 +1,94 @@
+include_guard(GLOBAL)
+include(xyz_generate_protocols)
+
+#[=======================================================================[.rst:
+xyz_add_protocol_library
+------------------------
+
+Overview
+^^^^^^^^
+Generates protocols whose instantiations for ``std::allocator`` are compiled
+once, into an object library, instead of in every translation unit that uses
+them.
+
+.. code-block:: cmake
+
+  xyz_add_protocol_library(
+      NAME <name>
+      [OUTPUT_DIRECTORY <directory>]
+      [LINK_LIBRARIES <libraries...>]
+      PROTOCOL
+        CLASS_NAME <name>
+        INTERFACE <header_file>
+        [INSTANTIATE <type>...]
+        [TYPE_HEADERS <header>...]
+        [<options of xyz_generate_protocols>...]
+      [PROTOCOL ...]
+  )
+   -- Generates protocols with extern templates and an object library that
+      instantiates them.
+
+  ``NAME``
+    The name of the object library. Targets that use the protocols link it.
+
+  ``OUTPUT_DIRECTORY``
+    The directory of outputs that are not given explicitly. Defaults to
+    ``${CMAKE_CURRENT_BINARY_DIR}/generated``.
+
+  ``LINK_LIBRARIES``
+    Libraries that the instantiations need, such as the protocol library and
+    the libraries of the ``INSTANTIATE`` types. They are linked publicly.
+
+  ``PROTOCOL``
+    Starts the description of one protocol, as for ``xyz_generate_protocols``
+    with ``EXTERN_TEMPLATES``.
+
+Every generated header declares ``protocol``, and ``unique_protocol`` and
+``memoized_protocol`` when they are generated, ``extern template`` for
+``std::allocator``. The library defines them, together with the vtables of the
+``INSTANTIATE`` types, so translation units only instantiate what they use with
+other allocators or types. To use the ``INSTANTIATE`` types without
+instantiating their vtables again, include
+``protocol_<CLASS_NAME>_instantiations.h`` instead of the generated header.
+
+#]=======================================================================]
+function(xyz_add_protocol_library)
+  list(FIND ARGN PROTOCOL XYZ_FIRST_PROTOCOL)
+  if(XYZ_FIRST_PROTOCOL EQUAL -1)
+    message(FATAL_ERROR "At least one PROTOCOL must be supplied")
+  endif()
+  list(SUBLIST ARGN 0 ${XYZ_FIRST_PROTOCOL} XYZ_LIBRARY_ARGS)
+  list(SUBLIST ARGN ${XYZ_FIRST_PROTOCOL} -1 XYZ_PROTOCOL_ARGS)
+
+  cmake_parse_arguments(XYZ_LIBRARY "" "NAME;OUTPUT_DIRECTORY"
+                        "LINK_LIBRARIES" ${XYZ_LIBRARY_ARGS})
+  if(NOT XYZ_LIBRARY_NAME)
+    message(FATAL_ERROR "NAME parameter must be supplied")
+  endif()
+
+  # Every protocol of the library is generated with extern templates.
+  set(XYZ_GENERATE_ARGS TARGET ${XYZ_LIBRARY_NAME})
+  if(XYZ_LIBRARY_OUTPUT_DIRECTORY)
+    list(APPEND XYZ_GENERATE_ARGS OUTPUT_DIRECTORY
+         ${XYZ_LIBRARY_OUTPUT_DIRECTORY})
+  endif()
+  foreach(XYZ_ARG IN LISTS XYZ_PROTOCOL_ARGS)
+    list(APPEND XYZ_GENERATE_ARGS ${XYZ_ARG})
+    if(XYZ_ARG STREQUAL "PROTOCOL")
+      list(APPEND XYZ_GENERATE_ARGS EXTERN_TEMPLATES)
+    endif()
+  endforeach()
+
+  add_library(${XYZ_LIBRARY_NAME} OBJECT)
+  target_compile_features(${XYZ_LIBRARY_NAME} PUBLIC cxx_std_20)
+  if(XYZ_LIBRARY_LINK_LIBRARIES)
+    target_link_libraries(${XYZ_LIBRARY_NAME}
+                          PUBLIC ${XYZ_LIBRARY_LINK_LIBRARIES})
+  endif()
+  if(CLANG_TIDY_ENABLE AND ClangTidy_FOUND)
+    set_target_properties(${XYZ_LIBRARY_NAME} PROPERTIES CXX_CLANG_TIDY
+                                                         "${XYZ_CLANG_TIDY}")
+  endif()
+
+  xyz_generate_protocols(${XYZ_GENERATE_ARGS})
+endfunction()
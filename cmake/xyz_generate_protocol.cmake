@@ -17,6 +17,12 @@ a Jinja2 template and a Python generation script.
       [OUTPUT <output_file>]
       [HEADER <include_header>]
       [MANUAL_VTABLE]
+      [MEMOIZE <method>...]
+      [UNIQUE]
+      [COMPACT]
+      [RELATIVE_VTABLES]
+      [OPTIMIZE_SIZE]
+      [DEBUG_DISPATCH]
   )
    -- Configures a custom command to generate protocol source files.
 
@@ -36,15 +42,99 @@ a Jinja2 template and a Python generation script.
     If specified, uses the manual vtable template for generation instead of the
     default.
 
+  ``UNIQUE``
+    If specified, the generated file also contains a move-only
+    ``xyz::unique_protocol`` specialization for ``CLASS_NAME``.
+
+  ``COMPACT``
+    If specified, the generated file also contains ``xyz::compact_protocol``
+    and ``xyz::compact_protocol_view`` specializations for ``CLASS_NAME``,
+    which are eight bytes each.
+
+  ``RELATIVE_VTABLES``
+    If specified, each generated vtable holds a single lookup function instead
+    of one pointer per entry, so it needs one load-time relocation. Interfaces
+    converted into one another must all use the same setting.
+
+  ``OPTIMIZE_SIZE``
+    If specified, the clone, move and destroy entries of owning vtables are
+    shared between interfaces, and between trivially copyable types of the same
+    size, instead of being instantiated for each interface. Interfaces
+    converted into one another must all use the same setting.
+
+  ``DEBUG_DISPATCH``
+    If specified, vtable entries are named static functions that forward
+    arguments with ``static_cast``, and the forwarding members of the generated
+    classes are always inlined, so that calls stay cheap in builds without
+    optimization. The vtable layout is unchanged.
+
+  ``MEMOIZE``
+    Const methods whose results ``xyz::memoized_protocol`` should cache. When
+    given, the generated file also contains a ``memoized_protocol``
+    specialization for ``CLASS_NAME``.
+
+The generator writes a depfile next to ``OUTPUT`` that lists every header the
+interface includes, so the output is regenerated when any of them changes.
+
+Generated headers are cached in ``XYZ_PROTOCOL_GENERATOR_CACHE_DIR``, keyed on
+the preprocessed interface, the template, the generator and the options above.
+An interface whose preprocessed content is unchanged is not parsed again. Set
+the variable to an empty string to disable the cache, or point several build
+trees at the same directory to share it.
+
+Generated headers are laid out by ``XYZ_PROTOCOL_GENERATOR_FORMATTER``:
+``whitespace`` (the default) tidies blank lines and trailing spaces in-process,
+``clang-format`` runs ``clang-format`` on each header as the checked-in
+reference is, and ``none`` writes the template output unchanged.
+
 #]=======================================================================]
+
+set(XYZ_PROTOCOL_GENERATOR_CACHE_DIR
+    "${CMAKE_BINARY_DIR}/xyz_protocol_generator_cache"
+    CACHE PATH "Directory of cached generated protocol headers")
+set(XYZ_PROTOCOL_GENERATOR_FORMATTER
+    "whitespace"
+    CACHE STRING "Formatting of generated protocol headers")
+set_property(CACHE XYZ_PROTOCOL_GENERATOR_FORMATTER
+             PROPERTY STRINGS whitespace clang-format none)
 macro(xyz_generate_protocol)
   set(oneValueArgs CLASS_NAME INTERFACE OUTPUT HEADER)
-  set(multiValueArgs "")
-  cmake_parse_arguments(XYZ_GENERATE "" "${oneValueArgs}"
+  set(multiValueArgs MEMOIZE)
+  cmake_parse_arguments(XYZ_GENERATE "UNIQUE;COMPACT;RELATIVE_VTABLES;OPTIMIZE_SIZE;DEBUG_DISPATCH" "${oneValueArgs}"
                         "${multiValueArgs}" ${ARGN})
 
   set(TEMPLATE_FILE ${CMAKE_CURRENT_SOURCE_DIR}/scripts/protocol.j2)
 
+  set(XYZ_GENERATE_EXTRA_ARGS "")
+  foreach(XYZ_GENERATE_METHOD IN LISTS XYZ_GENERATE_MEMOIZE)
+    list(APPEND XYZ_GENERATE_EXTRA_ARGS --memoize ${XYZ_GENERATE_METHOD})
+  endforeach()
+
+  if(XYZ_GENERATE_UNIQUE)
+    list(APPEND XYZ_GENERATE_EXTRA_ARGS --unique)
+  endif()
+
+  if(XYZ_GENERATE_COMPACT)
+    list(APPEND XYZ_GENERATE_EXTRA_ARGS --compact)
+  endif()
+
+  if(XYZ_GENERATE_RELATIVE_VTABLES)
+    list(APPEND XYZ_GENERATE_EXTRA_ARGS --relative-vtables)
+  endif()
+
+  if(XYZ_GENERATE_OPTIMIZE_SIZE)
+    list(APPEND XYZ_GENERATE_EXTRA_ARGS --optimize-size)
+  endif()
+
+  if(XYZ_GENERATE_DEBUG_DISPATCH)
+    list(APPEND XYZ_GENERATE_EXTRA_ARGS --debug-dispatch)
+  endif()
+
+  if(XYZ_PROTOCOL_GENERATOR_CACHE_DIR)
+    list(APPEND XYZ_GENERATE_EXTRA_ARGS --cache-dir
+         ${XYZ_PROTOCOL_GENERATOR_CACHE_DIR})
+  endif()
+
   get_filename_component(XYZ_GENERATE_OUTPUT_DIR "${XYZ_GENERATE_OUTPUT}" DIRECTORY)
   add_custom_command(
     OUTPUT ${XYZ_GENERATE_OUTPUT}
@@ -55,6 +145,10 @@ macro(xyz_generate_protocol)
       ${XYZ_GENERATE_INTERFACE} ${XYZ_GENERATE_OUTPUT} --class_name ${XYZ_GENERATE_CLASS_NAME}
       --template ${TEMPLATE_FILE} --compiler
       ${CMAKE_CXX_COMPILER} --header ${XYZ_GENERATE_HEADER}
+      --depfile ${XYZ_GENERATE_OUTPUT}.d
+      --formatter ${XYZ_PROTOCOL_GENERATOR_FORMATTER}
+      ${XYZ_GENERATE_EXTRA_ARGS}
+    DEPFILE ${XYZ_GENERATE_OUTPUT}.d
     DEPENDS ${XYZ_GENERATE_INTERFACE}
             ${CMAKE_CURRENT_SOURCE_DIR}/scripts/generate_protocol.py
             ${TEMPLATE_FILE}
@@ -0,0 +1,232 @@
+include_guard(GLOBAL)
+include(xyz_generate_protocol)
+
+#[=======================================================================[.rst:
+xyz_generate_protocols
+----------------------
+
+Overview
+^^^^^^^^
+Generates the protocols used by a target with a single invocation of the
+generator. Interfaces are parsed in parallel and system include paths are
+discovered once for the whole batch.
+
+.. code-block:: cmake
+
+  xyz_generate_protocols(
+      TARGET <target>
+      [OUTPUT_DIRECTORY <directory>]
+      PROTOCOL
+        CLASS_NAME <name>
+        INTERFACE <header_file>
+        [HEADER <include_header>]
+        [OUTPUT <output_file>]
+        [MEMOIZE <method>...]
+        [UNIQUE]
+        [COMPACT]
+        [RELATIVE_VTABLES]
+        [OPTIMIZE_SIZE]
+        [DEBUG_DISPATCH]
+        [EXTERN_TEMPLATES]
+        [MODULE]
+        [INSTANTIATE <type>...]
+        [TYPE_HEADERS <header>...]
+      [PROTOCOL ...]
+  )
+   -- Configures one custom command that generates every listed protocol.
+
+  ``TARGET``
+    An existing target that depends on the generated headers. Call the
+    function once per target.
+
+  ``OUTPUT_DIRECTORY``
+    The directory of outputs that are not given explicitly. Defaults to
+    ``${CMAKE_CURRENT_BINARY_DIR}/generated``.
+
+  ``PROTOCOL``
+    Starts the description of one protocol. ``CLASS_NAME``, ``INTERFACE`` and
+    the options are as for ``xyz_generate_protocol``. ``HEADER`` defaults to
+    the file name of ``INTERFACE`` and ``OUTPUT`` to
+    ``<OUTPUT_DIRECTORY>/protocol_<CLASS_NAME>.h``.
+
+  ``EXTERN_TEMPLATES``
+    If specified, the generated header declares the owning protocols for
+    ``std::allocator`` ``extern template``. Their explicit instantiations are
+    generated next to ``OUTPUT`` as ``protocol_<CLASS_NAME>_instantiations.cc``
+    and added to the sources of ``TARGET``, so ``TARGET`` must compile them.
+    Use ``xyz_add_protocol_library`` rather than setting this directly.
+
+  ``MODULE``
+    If specified, the module interface unit ``xyz.protocol.<CLASS_NAME>`` is
+    generated next to ``OUTPUT`` as ``protocol_<CLASS_NAME>_module.cc``. It is
+    not added to ``TARGET``, because CMake does not build header units.
+
+  ``INSTANTIATE``
+    Concrete types whose vtables the instantiations source also defines. They
+    are declared ``extern template`` in
+    ``protocol_<CLASS_NAME>_instantiations.h``, which includes the generated
+    header and ``TYPE_HEADERS``. Requires ``EXTERN_TEMPLATES``.
+
+  ``TYPE_HEADERS``
+    Headers, as they are included, that declare the ``INSTANTIATE`` types.
+
+The command is rerun when any interface of the batch, or any header they
+include, changes. Protocols whose preprocessed interface is unchanged are then
+copied from ``XYZ_PROTOCOL_GENERATOR_CACHE_DIR`` instead of being parsed again.
+The remaining interfaces that include the same system headers are parsed
+against one precompiled preamble of those headers. Outputs are formatted as
+set by ``XYZ_PROTOCOL_GENERATOR_FORMATTER``.
+
+#]=======================================================================]
+function(xyz_generate_protocols)
+  # Split the arguments at each PROTOCOL keyword.
+  set(XYZ_BATCH_ARGS "")
+  set(XYZ_PROTOCOL_COUNT 0)
+  foreach(XYZ_ARG IN LISTS ARGN)
+    if(XYZ_ARG STREQUAL "PROTOCOL")
+      math(EXPR XYZ_PROTOCOL_COUNT "${XYZ_PROTOCOL_COUNT} + 1")
+      set(XYZ_PROTOCOL_ARGS_${XYZ_PROTOCOL_COUNT} "")
+    elseif(XYZ_PROTOCOL_COUNT EQUAL 0)
+      list(APPEND XYZ_BATCH_ARGS ${XYZ_ARG})
+    else()
+      list(APPEND XYZ_PROTOCOL_ARGS_${XYZ_PROTOCOL_COUNT} ${XYZ_ARG})
+    endif()
+  endforeach()
+
+  cmake_parse_arguments(XYZ_BATCH "" "TARGET;OUTPUT_DIRECTORY" ""
+                        ${XYZ_BATCH_ARGS})
+  if(NOT XYZ_BATCH_TARGET)
+    message(FATAL_ERROR "TARGET parameter must be supplied")
+  endif()
+  if(NOT TARGET ${XYZ_BATCH_TARGET})
+    message(FATAL_ERROR "TARGET ${XYZ_BATCH_TARGET} does not exist")
+  endif()
+  set(XYZ_HEADERS_TARGET ${XYZ_BATCH_TARGET}_protocol_headers)
+  if(TARGET ${XYZ_HEADERS_TARGET})
+    message(
+      FATAL_ERROR
+        "xyz_generate_protocols was already called for ${XYZ_BATCH_TARGET}")
+  endif()
+  if(XYZ_PROTOCOL_COUNT EQUAL 0)
+    message(FATAL_ERROR "At least one PROTOCOL must be supplied")
+  endif()
+  if(NOT XYZ_BATCH_OUTPUT_DIRECTORY)
+    set(XYZ_BATCH_OUTPUT_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}/generated)
+  endif()
+
+  set(XYZ_MANIFEST "[]")
+  set(XYZ_OUTPUTS "")
+  set(XYZ_INTERFACES "")
+  set(XYZ_INSTANTIATIONS "")
+  foreach(XYZ_INDEX RANGE 1 ${XYZ_PROTOCOL_COUNT})
+    cmake_parse_arguments(
+      XYZ_GENERATE
+      "UNIQUE;COMPACT;RELATIVE_VTABLES;OPTIMIZE_SIZE;DEBUG_DISPATCH;EXTERN_TEMPLATES;MODULE"
+      "CLASS_NAME;INTERFACE;OUTPUT;HEADER" "MEMOIZE;INSTANTIATE;TYPE_HEADERS"
+      ${XYZ_PROTOCOL_ARGS_${XYZ_INDEX}})
+    if(NOT XYZ_GENERATE_CLASS_NAME OR NOT XYZ_GENERATE_INTERFACE)
+      message(FATAL_ERROR "Each PROTOCOL needs CLASS_NAME and INTERFACE")
+    endif()
+    get_filename_component(XYZ_GENERATE_INTERFACE "${XYZ_GENERATE_INTERFACE}"
+                           ABSOLUTE BASE_DIR ${CMAKE_CURRENT_SOURCE_DIR})
+    if(NOT XYZ_GENERATE_HEADER)
+      get_filename_component(XYZ_GENERATE_HEADER "${XYZ_GENERATE_INTERFACE}"
+                             NAME)
+    endif()
+    if(NOT XYZ_GENERATE_OUTPUT)
+      set(XYZ_GENERATE_OUTPUT
+          ${XYZ_BATCH_OUTPUT_DIRECTORY}/protocol_${XYZ_GENERATE_CLASS_NAME}.h)
+    endif()
+    list(APPEND XYZ_OUTPUTS ${XYZ_GENERATE_OUTPUT})
+    string(REGEX REPLACE "\\.[^./]*$" "" XYZ_STEM "${XYZ_GENERATE_OUTPUT}")
+    if(XYZ_GENERATE_EXTERN_TEMPLATES)
+      list(APPEND XYZ_OUTPUTS ${XYZ_STEM}_instantiations.h
+           ${XYZ_STEM}_instantiations.cc)
+      list(APPEND XYZ_INSTANTIATIONS ${XYZ_STEM}_instantiations.cc)
+    endif()
+    if(XYZ_GENERATE_MODULE)
+      list(APPEND XYZ_OUTPUTS ${XYZ_STEM}_module.cc)
+    endif()
+    list(APPEND XYZ_INTERFACES ${XYZ_GENERATE_INTERFACE})
+
+    # Paths and names are JSON strings; the flags are JSON booleans.
+    set(XYZ_ENTRY "{}")
+    foreach(XYZ_KEY input output class_name header)
+      string(TOUPPER ${XYZ_KEY} XYZ_VARIABLE)
+      if(XYZ_KEY STREQUAL "input")
+        set(XYZ_VARIABLE INTERFACE)
+      endif()
+      set(XYZ_VALUE "${XYZ_GENERATE_${XYZ_VARIABLE}}")
+      string(REPLACE "\\" "\\\\" XYZ_VALUE "${XYZ_VALUE}")
+      string(REPLACE "\"" "\\\"" XYZ_VALUE "${XYZ_VALUE}")
+      string(JSON XYZ_ENTRY SET "${XYZ_ENTRY}" ${XYZ_KEY} "\"${XYZ_VALUE}\"")
+    endforeach()
+    foreach(XYZ_FLAG UNIQUE COMPACT RELATIVE_VTABLES OPTIMIZE_SIZE
+                     DEBUG_DISPATCH EXTERN_TEMPLATES MODULE)
+      string(TOLOWER ${XYZ_FLAG} XYZ_KEY)
+      if(XYZ_GENERATE_${XYZ_FLAG})
+        string(JSON XYZ_ENTRY SET "${XYZ_ENTRY}" ${XYZ_KEY} true)
+      else()
+        string(JSON XYZ_ENTRY SET "${XYZ_ENTRY}" ${XYZ_KEY} false)
+      endif()
+    endforeach()
+    foreach(XYZ_LIST MEMOIZE INSTANTIATE TYPE_HEADERS)
+      string(TOLOWER ${XYZ_LIST} XYZ_KEY)
+      string(JSON XYZ_ENTRY SET "${XYZ_ENTRY}" ${XYZ_KEY} "[]")
+      set(XYZ_ITEM_INDEX 0)
+      foreach(XYZ_ITEM IN LISTS XYZ_GENERATE_${XYZ_LIST})
+        string(REPLACE "\\" "\\\\" XYZ_ITEM "${XYZ_ITEM}")
+        string(REPLACE "\"" "\\\"" XYZ_ITEM "${XYZ_ITEM}")
+        string(JSON XYZ_ENTRY SET "${XYZ_ENTRY}" ${XYZ_KEY} ${XYZ_ITEM_INDEX}
+               "\"${XYZ_ITEM}\"")
+        math(EXPR XYZ_ITEM_INDEX "${XYZ_ITEM_INDEX} + 1")
+      endforeach()
+    endforeach()
+
+    math(EXPR XYZ_POSITION "${XYZ_INDEX} - 1")
+    string(JSON XYZ_MANIFEST SET "${XYZ_MANIFEST}" ${XYZ_POSITION}
+           "${XYZ_ENTRY}")
+  endforeach()
+
+  # The manifest is only rewritten when it changes, so reconfiguring does not
+  # regenerate the batch.
+  set(XYZ_MANIFEST_FILE
+      ${CMAKE_CURRENT_BINARY_DIR}/xyz_protocols/${XYZ_BATCH_TARGET}.json)
+  file(GENERATE OUTPUT ${XYZ_MANIFEST_FILE} CONTENT "${XYZ_MANIFEST}\n")
+
+  set(XYZ_CACHE_ARGS "")
+  if(XYZ_PROTOCOL_GENERATOR_CACHE_DIR)
+    set(XYZ_CACHE_ARGS --cache-dir ${XYZ_PROTOCOL_GENERATOR_CACHE_DIR})
+  endif()
+
+  set(TEMPLATE_FILE ${CMAKE_CURRENT_SOURCE_DIR}/scripts/protocol.j2)
+  # The generator finds its other templates next to TEMPLATE_FILE. The depfile
+  # lists only the interfaces' includes, so the templates are listed here.
+  set(XYZ_TEMPLATES ${TEMPLATE_FILE}
+      ${CMAKE_CURRENT_SOURCE_DIR}/scripts/protocol_instantiations.j2
+      ${CMAKE_CURRENT_SOURCE_DIR}/scripts/protocol_module.j2)
+  add_custom_command(
+    OUTPUT ${XYZ_OUTPUTS}
+    COMMAND
+      ${Python3_EXECUTABLE}
+      ${CMAKE_CURRENT_SOURCE_DIR}/scripts/generate_protocol.py --batch
+      ${XYZ_MANIFEST_FILE} --template ${TEMPLATE_FILE} --compiler
+      ${CMAKE_CXX_COMPILER} --depfile ${XYZ_MANIFEST_FILE}.d --formatter
+      ${XYZ_PROTOCOL_GENERATOR_FORMATTER} ${XYZ_CACHE_ARGS}
+    DEPFILE ${XYZ_MANIFEST_FILE}.d
+    DEPENDS ${XYZ_INTERFACES}
+            ${XYZ_MANIFEST_FILE}
+            ${CMAKE_CURRENT_SOURCE_DIR}/scripts/generate_protocol.py
+            ${XYZ_TEMPLATES}
+    WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
+    COMMENT "Generating ${XYZ_PROTOCOL_COUNT} protocols for ${XYZ_BATCH_TARGET}"
+  )
+  set_source_files_properties(${XYZ_OUTPUTS} PROPERTIES GENERATED TRUE)
+
+  if(XYZ_INSTANTIATIONS)
+    target_sources(${XYZ_BATCH_TARGET} PRIVATE ${XYZ_INSTANTIATIONS})
+  endif()
+
+  add_custom_target(${XYZ_HEADERS_TARGET} DEPENDS ${XYZ_OUTPUTS})
+  add_dependencies(${XYZ_BATCH_TARGET} ${XYZ_HEADERS_TARGET})
+endfunction()
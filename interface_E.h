@@ -0,0 +1,44 @@
+#ifndef XYZ_PROTOCOL_INTERFACE_E_H
+#define XYZ_PROTOCOL_INTERFACE_E_H
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xyz {
+
+// A by-value argument that counts how often it is moved.
+struct Payload {
+  std::vector<int> data;
+  int* moves = nullptr;
+
+  Payload() = default;
+  Payload(std::vector<int> d, int* m) : data(std::move(d)), moves(m) {}
+  Payload(const Payload&) = default;
+  Payload(Payload&& other) noexcept
+      : data(std::move(other.data)), moves(other.moves) {
+    if (moves != nullptr) {
+      ++*moves;
+    }
+  }
+  Payload& operator=(const Payload&) = default;
+  Payload& operator=(Payload&&) = default;
+};
+
+// A large trivially copyable argument.
+struct Block {
+  std::array<int, 64> values;
+};
+
+struct E {
+  std::size_t consume(Payload payload);
+  std::size_t inspect(Payload payload) const;
+  std::size_t length(std::string s) const;
+  int scale(int x) const;
+  int sum(Block block) const;
+};
+
+}  // namespace xyz
+#endif  // XYZ_PROTOCOL_INTERFACE_E_H
@@ -0,0 +1,16 @@
+#ifndef XYZ_PROTOCOL_INTERFACE_F_H
+#define XYZ_PROTOCOL_INTERFACE_F_H
+
+#include <cstddef>
+#include <vector>
+
+namespace xyz {
+
+struct F {
+  void push(int x) &;
+  std::size_t size() const&;
+  std::vector<int> take() &&;
+};
+
+}  // namespace xyz
+#endif  // XYZ_PROTOCOL_INTERFACE_F_H
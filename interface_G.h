@@ -0,0 +1,14 @@
+#ifndef XYZ_PROTOCOL_INTERFACE_G_H
+#define XYZ_PROTOCOL_INTERFACE_G_H
+#include <string_view>
+
+namespace xyz {
+
+struct G {
+  std::string_view name() const noexcept;
+  int count();
+  int scale(int x) const;
+};
+
+}  // namespace xyz
+#endif  // XYZ_PROTOCOL_INTERFACE_G_H
@@ -0,0 +1,12 @@
+#ifndef XYZ_PROTOCOL_INTERFACE_G_SUBSET_H
+#define XYZ_PROTOCOL_INTERFACE_G_SUBSET_H
+#include <string_view>
+
+namespace xyz {
+
+struct G_Subset {
+  std::string_view name() const noexcept;
+};
+
+}  // namespace xyz
+#endif  // XYZ_PROTOCOL_INTERFACE_G_SUBSET_H
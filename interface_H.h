@@ -0,0 +1,13 @@
+#ifndef XYZ_PROTOCOL_INTERFACE_H_H
+#define XYZ_PROTOCOL_INTERFACE_H_H
+#include <string_view>
+
+namespace xyz {
+
+struct H {
+  std::string_view name() const noexcept;
+  int count();
+};
+
+}  // namespace xyz
+#endif  // XYZ_PROTOCOL_INTERFACE_H_H
@@ -0,0 +1,18 @@
+#ifndef XYZ_PROTOCOL_INTERFACE_I_H
+#define XYZ_PROTOCOL_INTERFACE_I_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace xyz {
+
+struct I {
+  std::string_view name() const noexcept;
+  std::size_t consume(std::vector<int> values);
+  void push(int x) &;
+  std::vector<int> take() &&;
+};
+
+}  // namespace xyz
+#endif  // XYZ_PROTOCOL_INTERFACE_I_H
@@ -0,0 +1,46 @@
+#ifndef XYZ_PROTOCOL_INTERFACE_PIPELINE_H
+#define XYZ_PROTOCOL_INTERFACE_PIPELINE_H
+
+#include <array>
+#include <cstdint>
+
+namespace xyz {
+
+// An event as it arrives: a source that selects the parser, and its encoding.
+struct RawEvent {
+  std::uint64_t id;
+  std::uint32_t source;
+  std::uint32_t length;
+  std::array<char, 48> data;
+};
+
+// An event after parsing and enrichment.
+struct Event {
+  std::uint64_t id;
+  std::uint32_t user;
+  std::uint32_t kind;
+  std::int64_t amount;
+  std::uint32_t region;
+  std::uint32_t score;
+};
+
+// The stages of an event-processing pipeline.
+struct EventParser {
+  bool parse(const RawEvent& raw, Event& event) const;
+};
+
+struct EventFilter {
+  bool accept(const Event& event) const;
+};
+
+struct EventEnricher {
+  void enrich(Event& event) const;
+};
+
+struct EventSink {
+  void consume(const Event& event);
+  std::uint64_t checksum() const;
+};
+
+}  // namespace xyz
+#endif  // XYZ_PROTOCOL_INTERFACE_PIPELINE_H
@@ -0,0 +1,158 @@
+/* Copyright (c) 2016 The Value Types Authors. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+==============================================================================*/
+
+#ifndef XYZ_PERF_COUNTERS_H
+#define XYZ_PERF_COUNTERS_H
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace xyz {
+
+// Counts hardware events while a benchmark runs and reports them per
+// iteration as user counters. Construct it immediately before the timed loop:
+//
+//   xyz::PerfCounters perf_counters(state);
+//   for (auto _ : state) { ... }
+//
+// The counters are `cycles`, `instructions`, `branch_misses`, `l1d_misses`,
+// `llc_misses` and `itlb_misses`, read with `perf_event_open` for the calling
+// thread in user space. An event the kernel or the CPU cannot count is left
+// out, and if none can be counted a single warning is printed. On other
+// platforms nothing is counted.
+class PerfCounters {
+ public:
+  explicit PerfCounters(benchmark::State& state) : state_(state) {
+#if defined(__linux__)
+    int error = 0;
+    for (const Event& event : kEvents) {
+      perf_event_attr attr{};
+      attr.size = sizeof(attr);
+      attr.type = event.type;
+      attr.config = event.config;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      // More events than the CPU has counters are multiplexed. The times let
+      // `read` scale each count to the whole run.
+      attr.read_format =
+          PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      int fd = static_cast<int>(
+          syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+      if (fd == -1) {
+        error = errno;
+        continue;
+      }
+      counters_[size_++] = {event.name, fd};
+    }
+    if (size_ == 0) {
+      static bool warned = false;
+      if (!warned) {
+        warned = true;
+        std::fprintf(stderr,
+                     "Hardware performance counters are unavailable: %s\n",
+                     std::strerror(error));
+      }
+    }
+    for (int i = 0; i < size_; ++i) {
+      ioctl(counters_[i].fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(counters_[i].fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  ~PerfCounters() {
+#if defined(__linux__)
+    for (int i = 0; i < size_; ++i) {
+      ioctl(counters_[i].fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+    for (int i = 0; i < size_; ++i) {
+      struct {
+        std::uint64_t value;
+        std::uint64_t time_enabled;
+        std::uint64_t time_running;
+      } reading{};
+      if (::read(counters_[i].fd, &reading, sizeof(reading)) ==
+              static_cast<ssize_t>(sizeof(reading)) &&
+          reading.time_running != 0) {
+        state_.counters[counters_[i].name] = benchmark::Counter(
+            static_cast<double>(reading.value) *
+                static_cast<double>(reading.time_enabled) /
+                static_cast<double>(reading.time_running),
+            benchmark::Counter::kAvgIterations);
+      }
+      close(counters_[i].fd);
+    }
+#endif
+  }
+
+ private:
+  [[maybe_unused]] benchmark::State& state_;
+
+#if defined(__linux__)
+  struct Event {
+    const char* name;
+    std::uint32_t type;
+    std::uint64_t config;
+  };
+
+  // Cache events select the cache, the operation and the result.
+  static constexpr std::uint64_t kReadMiss =
+      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+  static constexpr Event kEvents[] = {
+      {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+      {"l1d_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | kReadMiss},
+      {"llc_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | kReadMiss},
+      {"itlb_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_ITLB | kReadMiss},
+  };
+
+  struct Counter {
+    const char* name;
+    int fd;
+  };
+
+  Counter counters_[std::size(kEvents)] = {};
+  int size_ = 0;
+#endif
+};
+
+}  // namespace xyz
+
+#endif  // XYZ_PERF_COUNTERS_H
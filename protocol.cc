@@ -20,11 +20,19 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "protocol.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace xyz {
 namespace {
@@ -55,8 +63,110 @@ struct CacheKeyHash {
   }
 };
 
+// Bookkeeping for the compact arena. Free blocks are kept per size, in
+// granules, as offsets from the arena base.
+struct CompactArenaState {
+  std::mutex mutex;
+  std::size_t capacity = compact_arena::default_capacity;
+  std::size_t used = 0;
+  std::unordered_map<std::size_t, std::vector<std::uint32_t>> free_blocks;
+};
+
+CompactArenaState& compact_arena_state() {
+  // Leaked for the same reason as the vtable cache below.
+  static auto& state = *new CompactArenaState();
+  return state;
+}
+
+std::size_t granules_for(std::size_t bytes) {
+  return (bytes + compact_arena::granule - 1) / compact_arena::granule;
+}
+
 }  // namespace
 
+const void* compact_vtables[max_compact_vtables] = {};
+
+std::byte* compact_arena::base_ = nullptr;
+
+bool compact_arena::reserve(std::size_t capacity) {
+  auto& state = compact_arena_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (base_ != nullptr || capacity > granule * (std::size_t{1} << 32)) {
+    return false;
+  }
+  state.capacity = capacity;
+  return true;
+}
+
+void* compact_arena::allocate(std::size_t bytes, std::size_t alignment) {
+  assert(alignment <= max_alignment);
+  auto& state = compact_arena_state();
+  const std::size_t granules = granules_for(bytes);
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (base_ == nullptr) {
+    // The reservation is never released. Untouched pages are typically not
+    // committed, so a large capacity costs address space only.
+    base_ = static_cast<std::byte*>(::operator new(
+        state.capacity, std::align_val_t{max_alignment}));
+  }
+
+  auto free_list = state.free_blocks.find(granules);
+  if (free_list != state.free_blocks.end()) {
+    auto& offsets = free_list->second;
+    for (auto it = offsets.rbegin(); it != offsets.rend(); ++it) {
+      if ((std::size_t{*it} * granule) % alignment == 0) {
+        void* p = address_of(*it);
+        offsets.erase(std::next(it).base());
+        return p;
+      }
+    }
+  }
+
+  // Blocks start on a granule boundary so that their offset is exact.
+  alignment = std::max(alignment, granule);
+  const std::size_t start =
+      (state.used + alignment - 1) / alignment * alignment;
+  if (start + granules * granule > state.capacity) {
+    throw std::bad_alloc();
+  }
+  state.used = start + granules * granule;
+  return base_ + start;
+}
+
+void compact_arena::deallocate(void* p, std::size_t bytes) noexcept {
+  auto& state = compact_arena_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  // Recycling a block must not throw; if recording it fails, it is leaked.
+  try {
+    state.free_blocks[granules_for(bytes)].push_back(offset_of(p));
+  } catch (...) {
+  }
+}
+
+std::uint32_t register_compact_vtables(const void* owning_vtable,
+                                       const void* view_vtable) {
+  static auto& indices = *new std::unordered_map<const void*, std::uint32_t>();
+  static auto& mutex = *new std::mutex();
+  static std::uint32_t next_index = 1;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto found = indices.find(owning_vtable);
+  if (found != indices.end()) {
+    return found->second;
+  }
+  if (next_index + 2 > max_compact_vtables) {
+    throw std::length_error("xyz::compact_vtables is full");
+  }
+  // Slots are written once, before their index is handed out, so readers that
+  // obtained an index from a compact protocol never race with this write.
+  compact_vtables[next_index] = owning_vtable;
+  compact_vtables[next_index + 1] = view_vtable;
+  indices.emplace(owning_vtable, next_index);
+  const std::uint32_t index = next_index;
+  next_index += 2;
+  return index;
+}
+
 const void* get_mapped_vtable(const void* source_vtable_pointer,
                               const void* conversion_anchor,
                               std::size_t target_vtable_size,
@@ -103,4 +213,100 @@ const void* get_mapped_vtable(const void* source_vtable_pointer,
   return inserted_iterator->second.get();
 }
 
+std::atomic<deferred_destroyer*> deferred_destroyer::active_ = nullptr;
+std::atomic<std::size_t> deferred_destroyer::in_flight_ = 0;
+
+deferred_destroyer::deferred_destroyer()
+    : stop_node_{nullptr, [](node*) noexcept {}} {
+  deferred_destroyer* expected = nullptr;
+  [[maybe_unused]] bool installed = active_.compare_exchange_strong(
+      expected, this, std::memory_order_acq_rel);
+  assert(installed && "Only one deferred_destroyer may be active at a time.");
+  worker_ = std::thread([this] { run(); });
+}
+
+deferred_destroyer::~deferred_destroyer() {
+  // Uninstall only this destroyer: one that failed to install must not
+  // deactivate the one that did.
+  deferred_destroyer* expected = this;
+  active_.compare_exchange_strong(expected, nullptr,
+                                  std::memory_order_seq_cst);
+  // A producer that loaded `active_` before it was cleared may still push
+  // here. New producers see another destroyer or none. The exchange above and
+  // this load pair with the producer's increment of `in_flight_` and load of
+  // `active_`: with all four seq_cst, either this load sees the increment or
+  // the producer sees nullptr. A weaker load could miss the increment of a
+  // producer that still sees this destroyer.
+  while (in_flight_.load(std::memory_order_seq_cst) != 0) {
+    std::this_thread::yield();
+  }
+  stopping_.store(true, std::memory_order_release);
+  push(&stop_node_);
+  worker_.join();
+  // Destroy anything pushed by producers that observed this destroyer as
+  // active after the worker took its last batch.
+  destroy_batch(head_.exchange(nullptr, std::memory_order_acquire));
+}
+
+void deferred_destroyer::push(node* n) noexcept {
+  if (n != &stop_node_) {
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+  }
+  node* head = head_.load(std::memory_order_relaxed);
+  do {
+    n->next = head;
+  } while (!head_.compare_exchange_weak(head, n, std::memory_order_release,
+                                        std::memory_order_relaxed));
+  if (head == nullptr) {
+    head_.notify_one();
+  }
+}
+
+void deferred_destroyer::flush() noexcept {
+  std::size_t target = pushed_.load(std::memory_order_relaxed);
+  std::size_t done = destroyed_.load(std::memory_order_acquire);
+  while (done < target) {
+    destroyed_.wait(done, std::memory_order_acquire);
+    done = destroyed_.load(std::memory_order_acquire);
+  }
+}
+
+std::size_t deferred_destroyer::destroy_batch(node* batch) noexcept {
+  // The stack yields the most recent release first; reverse it so that
+  // objects are destroyed in the order they were released.
+  node* ordered = nullptr;
+  while (batch != nullptr) {
+    node* next = batch->next;
+    batch->next = ordered;
+    ordered = batch;
+    batch = next;
+  }
+
+  std::size_t count = 0;
+  while (ordered != nullptr) {
+    node* next = ordered->next;
+    if (ordered != &stop_node_) {
+      ++count;
+    }
+    ordered->destroy(ordered);
+    ordered = next;
+  }
+  return count;
+}
+
+void deferred_destroyer::run() noexcept {
+  for (;;) {
+    node* batch = head_.exchange(nullptr, std::memory_order_acquire);
+    if (batch == nullptr) {
+      if (stopping_.load(std::memory_order_acquire)) {
+        return;
+      }
+      head_.wait(nullptr, std::memory_order_acquire);
+      continue;
+    }
+    destroyed_.fetch_add(destroy_batch(batch), std::memory_order_release);
+    destroyed_.notify_all();
+  }
+}
+
 }  // namespace xyz
@@ -19,11 +19,29 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 ==============================================================================*/
 #ifndef XYZ_PROTOCOL_H_
 #define XYZ_PROTOCOL_H_
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <memory>
 #include <mutex>
-#include <unordered_map>
+#include <new>
+#include <thread>
 #include <utility>
 
+// Forces inlining of the forwarding members of protocols generated with
+// DEBUG_DISPATCH, which compilers otherwise keep out of line without
+// optimization.
+#if defined(__GNUC__)
+#define XYZ_PROTOCOL_ALWAYS_INLINE [[gnu::always_inline]] inline
+#elif defined(_MSC_VER)
+#define XYZ_PROTOCOL_ALWAYS_INLINE [[msvc::forceinline]] inline
+#else
+#define XYZ_PROTOCOL_ALWAYS_INLINE inline
+#endif
+
 namespace xyz {
 
 template <typename T>
@@ -35,6 +53,24 @@ class protocol;
 template <typename T, typename Alloc>
 struct is_protocol<protocol<T, Alloc>> : std::true_type {};
 
+// A move-only owning protocol. It accepts types that are not copy
+// constructible and its vtable has no clone entry. A specialization is
+// generated by `xyz_generate_protocol` when the UNIQUE option is given.
+template <typename T, typename Alloc = std::allocator<T>>
+class unique_protocol;
+
+template <typename T, typename Alloc>
+struct is_protocol<unique_protocol<T, Alloc>> : std::true_type {};
+
+// An owning protocol packed into eight bytes: a 32-bit index into the compact
+// vtable table and a 32-bit offset into the `compact_arena`. A specialization
+// is generated by `xyz_generate_protocol` when the COMPACT option is given.
+template <typename T>
+class compact_protocol;
+
+template <typename T>
+struct is_protocol<compact_protocol<T>> : std::true_type {};
+
 template <typename T>
 struct is_protocol_view : std::false_type {};
 
@@ -44,19 +80,75 @@ class protocol_view;
 template <typename T>
 struct is_protocol_view<protocol_view<T>> : std::true_type {};
 
+// An eight-byte view of an object owned by a `compact_protocol`.
+template <typename T>
+class compact_protocol_view;
+
+template <typename T>
+struct is_protocol_view<compact_protocol_view<T>> : std::true_type {};
+
 template <typename T>
 concept not_protocol_or_view = !is_protocol<std::remove_cvref_t<T>>::value &&
                                !is_protocol_view<std::remove_cvref_t<T>>::value;
 
+// Identifies the concrete type held by a protocol or protocol_view. Every
+// generated vtable records the token of the type it dispatches to, and the
+// narrowing conversions copy it into mapped vtables, so type queries remain
+// O(1) after conversion.
+using type_token = const void*;
+
+// The anchors are not `const`: identical read-only constants may share an
+// address under `-fmerge-all-constants`, `--icf=all` or `/OPT:ICF`, which
+// would make every token compare equal. Writable variables are never merged.
+template <typename T>
+inline char type_token_anchor = 0;
+
+template <typename T>
+inline constexpr type_token type_token_for = &type_token_anchor<T>;
+
 template <typename Protocol>
 struct protocol_vtable_traits;
 
+// `conversion_anchor` identifies the conversion. Like `type_token_anchor`, it
+// must be the address of a writable variable so that it is never merged.
 const void* get_mapped_vtable(const void* source_vtable_pointer,
                               const void* conversion_anchor,
                               std::size_t target_vtable_size,
                               void (*mapping_function)(const void* source,
                                                        void* target));
 
+// Vtables generated with `--relative-vtables` hold a single lookup function in
+// place of one pointer per entry. The lookup for a concrete type is a `switch`,
+// which compilers lower to a table of 32-bit PC-relative offsets in read-only
+// memory, so a program needs one load-time relocation per vtable instead of one
+// per entry.
+using relative_vtable_lookup = const void* (*)(const void* vtable,
+                                               std::size_t index) noexcept;
+
+// A relative vtable built at run time by a narrowing conversion stores its
+// entries directly after the lookup function.
+inline const void** mapped_relative_vtable_entries(void* vtable) noexcept {
+  return reinterpret_cast<const void**>(static_cast<char*>(vtable) +
+                                        sizeof(relative_vtable_lookup));
+}
+
+inline const void* mapped_relative_vtable_lookup(const void* vtable,
+                                                 std::size_t index) noexcept {
+  return reinterpret_cast<const void* const*>(
+      static_cast<const char*>(vtable) + sizeof(relative_vtable_lookup))[index];
+}
+
+// The number of bytes a narrowing conversion allocates for a `Vtable`.
+template <typename Vtable>
+constexpr std::size_t mapped_vtable_size() noexcept {
+  if constexpr (requires { Vtable::xyz_protocol_size; }) {
+    return sizeof(relative_vtable_lookup) +
+           Vtable::xyz_protocol_size * sizeof(const void*);
+  } else {
+    return sizeof(Vtable);
+  }
+}
+
 template <typename FromProtocol, typename ToProtocol>
 const typename protocol_vtable_traits<ToProtocol>::const_vtable* get_vtable(
     const typename protocol_vtable_traits<FromProtocol>::const_vtable*
@@ -65,7 +157,7 @@ const typename protocol_vtable_traits<ToProtocol>::const_vtable* get_vtable(
       typename protocol_vtable_traits<FromProtocol>::const_vtable;
   using ToVtable = typename protocol_vtable_traits<ToProtocol>::const_vtable;
 
-  static const char conversion_anchor = 0;
+  static char conversion_anchor = 0;
 
   auto mapping_function = [](const void* source, void* target) {
     map_vtable_members(static_cast<const FromVtable*>(source),
@@ -74,7 +166,7 @@ const typename protocol_vtable_traits<ToProtocol>::const_vtable* get_vtable(
 
   return static_cast<const ToVtable*>(
       get_mapped_vtable(source_vtable_pointer, &conversion_anchor,
-                        sizeof(ToVtable), mapping_function));
+                        mapped_vtable_size<ToVtable>(), mapping_function));
 }
 
 template <typename FromProtocol, typename ToProtocol>
@@ -84,7 +176,7 @@ const typename protocol_vtable_traits<ToProtocol>::vtable* get_mutable_vtable(
   using FromVtable = typename protocol_vtable_traits<FromProtocol>::vtable;
   using ToVtable = typename protocol_vtable_traits<ToProtocol>::vtable;
 
-  static const char conversion_anchor = 0;
+  static char conversion_anchor = 0;
 
   auto mapping_function = [](const void* source, void* target) {
     map_mutable_vtable_members(static_cast<const FromVtable*>(source),
@@ -93,25 +185,32 @@ const typename protocol_vtable_traits<ToProtocol>::vtable* get_mutable_vtable(
 
   return static_cast<const ToVtable*>(
       get_mapped_vtable(source_vtable_pointer, &conversion_anchor,
-                        sizeof(ToVtable), mapping_function));
+                        mapped_vtable_size<ToVtable>(), mapping_function));
 }
 
 template <typename Protocol, typename Allocator>
 struct protocol_owning_vtable_traits;
 
-template <typename FromProtocol, typename ToProtocol, typename Allocator>
-const typename protocol_owning_vtable_traits<ToProtocol, Allocator>::vtable*
-get_owning_vtable(const typename protocol_owning_vtable_traits<
-                  FromProtocol, Allocator>::vtable* source_vtable_pointer) {
+template <typename Protocol, typename Allocator>
+struct unique_protocol_owning_vtable_traits;
+
+// Maps an owning vtable of `FromProtocol` onto one for `ToProtocol`. The traits
+// select the owning wrapper on each side: `protocol_owning_vtable_traits` for
+// `protocol` and `unique_protocol_owning_vtable_traits` for `unique_protocol`.
+template <typename FromProtocol, typename ToProtocol, typename Allocator,
+          template <typename, typename> class FromTraits =
+              protocol_owning_vtable_traits,
+          template <typename, typename> class ToTraits = FromTraits>
+const typename ToTraits<ToProtocol, Allocator>::vtable* get_owning_vtable(
+    const typename FromTraits<FromProtocol, Allocator>::vtable*
+        source_vtable_pointer) {
   if (source_vtable_pointer == nullptr) {
     return nullptr;
   }
-  using FromVtable =
-      typename protocol_owning_vtable_traits<FromProtocol, Allocator>::vtable;
-  using ToVtable =
-      typename protocol_owning_vtable_traits<ToProtocol, Allocator>::vtable;
+  using FromVtable = typename FromTraits<FromProtocol, Allocator>::vtable;
+  using ToVtable = typename ToTraits<ToProtocol, Allocator>::vtable;
 
-  static const char conversion_anchor = 0;
+  static char conversion_anchor = 0;
 
   auto mapping_function = [](const void* source, void* target) {
     map_owning_vtable_members(static_cast<const FromVtable*>(source),
@@ -120,9 +219,477 @@ get_owning_vtable(const typename protocol_owning_vtable_traits<
 
   return static_cast<const ToVtable*>(
       get_mapped_vtable(source_vtable_pointer, &conversion_anchor,
-                        sizeof(ToVtable), mapping_function));
+                        mapped_vtable_size<ToVtable>(), mapping_function));
+}
+
+// The parameter type used in generated vtable signatures for an interface
+// parameter of type `T`. References and small trivially copyable types are
+// passed unchanged. Other by-value parameters are passed by rvalue reference
+// from the generated wrapper to the concrete method, so they are moved once, at
+// the final call, rather than once per call layer.
+template <typename T>
+using vtable_parameter_t =
+    std::conditional_t<std::is_reference_v<T> ||
+                           (std::is_trivially_copyable_v<T> &&
+                            sizeof(T) <= 2 * sizeof(void*)),
+                       T, T&&>;
+
+// Tag selecting the constructors that take ownership of an object which has
+// already been allocated and constructed, instead of allocating a new one.
+struct adopt_t {
+  explicit adopt_t() = default;
+};
+
+inline constexpr adopt_t adopt{};
+
+// Destroys and deallocates a `T` through `Allocator` rebound to `T`. This is
+// the deleter of the `std::unique_ptr` returned by `release()`, so an object
+// can move between a protocol and a `std::unique_ptr` without reallocation.
+template <typename T, typename Allocator>
+class allocator_delete {
+  [[no_unique_address]] Allocator alloc_;
+
+ public:
+  using allocator_type = Allocator;
+
+  explicit allocator_delete(const Allocator& alloc) noexcept : alloc_(alloc) {}
+
+  void operator()(T* ptr) const noexcept {
+    using t_allocator =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+    using t_alloc_traits = std::allocator_traits<t_allocator>;
+    t_allocator t_alloc(alloc_);
+    t_alloc_traits::destroy(t_alloc, ptr);
+    t_alloc_traits::deallocate(t_alloc, ptr, 1);
+  }
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+};
+
+// Specialize as `true` for a stateful allocator so that owning protocols store
+// it in the heap block in front of the owned object instead of inline, which
+// keeps `sizeof(protocol)` at two pointers. A valueless protocol then has no
+// allocator, and adopt/release are unavailable.
+template <typename Allocator>
+inline constexpr bool enable_out_of_line_allocator = false;
+
+// Stands in for the allocator member of a protocol whose allocator is stored
+// out of line.
+struct out_of_line_allocator_slot {
+  out_of_line_allocator_slot() = default;
+
+  template <typename Allocator>
+  explicit out_of_line_allocator_slot(const Allocator&) noexcept {}
+};
+
+template <typename Allocator>
+using protocol_allocator_member_t =
+    std::conditional_t<enable_out_of_line_allocator<Allocator>,
+                       out_of_line_allocator_slot, Allocator>;
+
+// Allocates, constructs and destroys the objects owned by protocols. Inline,
+// an object occupies its own allocation. Out of line, a copy of the allocator
+// is placed immediately before the object, so it can be found from the object
+// pointer alone without knowing the object's type.
+template <typename Allocator>
+struct protocol_storage {
+  static constexpr bool out_of_line = enable_out_of_line_allocator<Allocator>;
+
+  template <typename T>
+  struct layout {
+    static constexpr std::size_t offset =
+        (sizeof(Allocator) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+    struct alignas(alignof(T) > alignof(Allocator) ? alignof(T)
+                                                   : alignof(Allocator)) block {
+      std::byte bytes[offset + sizeof(T)];
+    };
+  };
+
+  template <typename T, typename... Ts>
+  static T* create(const Allocator& alloc, Ts&&... ts) {
+    using t_allocator =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+    using t_alloc_traits = std::allocator_traits<t_allocator>;
+    t_allocator t_alloc(alloc);
+    if constexpr (out_of_line) {
+      using block = typename layout<T>::block;
+      using block_allocator = typename std::allocator_traits<
+          Allocator>::template rebind_alloc<block>;
+      using block_alloc_traits = std::allocator_traits<block_allocator>;
+      block_allocator b_alloc(alloc);
+      block* mem = block_alloc_traits::allocate(b_alloc, 1);
+      T* object = reinterpret_cast<T*>(mem->bytes + layout<T>::offset);
+      try {
+        t_alloc_traits::construct(t_alloc, object, std::forward<Ts>(ts)...);
+      } catch (...) {
+        block_alloc_traits::deallocate(b_alloc, mem, 1);
+        throw;
+      }
+      ::new (static_cast<void*>(reinterpret_cast<std::byte*>(object) -
+                                sizeof(Allocator))) Allocator(alloc);
+      return object;
+    } else {
+      T* mem = t_alloc_traits::allocate(t_alloc, 1);
+      try {
+        t_alloc_traits::construct(t_alloc, mem, std::forward<Ts>(ts)...);
+        return mem;
+      } catch (...) {
+        t_alloc_traits::deallocate(t_alloc, mem, 1);
+        throw;
+      }
+    }
+  }
+
+  // Out of line, `alloc` is ignored in favour of the stored allocator.
+  template <typename T>
+  static void destroy(T* object, const Allocator& alloc) noexcept {
+    using t_allocator =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+    using t_alloc_traits = std::allocator_traits<t_allocator>;
+    if constexpr (out_of_line) {
+      using block = typename layout<T>::block;
+      using block_allocator = typename std::allocator_traits<
+          Allocator>::template rebind_alloc<block>;
+      Allocator* stored = std::launder(reinterpret_cast<Allocator*>(
+          reinterpret_cast<std::byte*>(object) - sizeof(Allocator)));
+      block_allocator b_alloc(*stored);
+      t_allocator t_alloc(*stored);
+      t_alloc_traits::destroy(t_alloc, object);
+      stored->~Allocator();
+      std::allocator_traits<block_allocator>::deallocate(
+          b_alloc,
+          reinterpret_cast<block*>(reinterpret_cast<std::byte*>(object) -
+                                   layout<T>::offset),
+          1);
+    } else {
+      t_allocator t_alloc(alloc);
+      t_alloc_traits::destroy(t_alloc, object);
+      t_alloc_traits::deallocate(t_alloc, object, 1);
+    }
+  }
+
+  // The allocator stored in front of a live out-of-line object.
+  static const Allocator& allocator(const void* object) noexcept
+    requires out_of_line
+  {
+    return *std::launder(reinterpret_cast<const Allocator*>(
+        static_cast<const std::byte*>(object) - sizeof(Allocator)));
+  }
+};
+
+// The allocator type taken by the lifetime entries of owning vtables generated
+// with `--optimize-size`. A stateless allocator that converts implicitly is
+// rebound to `std::byte`, so `protocol<A>` and `protocol<B>` with their default
+// `std::allocator<A>` and `std::allocator<B>` share the entries of a concrete
+// type. Other allocators are used unchanged.
+template <typename Allocator>
+using protocol_thunk_allocator_t = std::conditional_t<
+    std::is_empty_v<Allocator> &&
+        std::allocator_traits<Allocator>::is_always_equal::value &&
+        !enable_out_of_line_allocator<Allocator> &&
+        std::is_convertible_v<const Allocator&,
+                              typename std::allocator_traits<
+                                  Allocator>::template rebind_alloc<std::byte>>,
+    typename std::allocator_traits<Allocator>::template rebind_alloc<std::byte>,
+    Allocator>;
+
+// Copies, moves and destroys a `T` owned through `Allocator`. Generated code
+// uses these functions as owning vtable entries when it is generated with
+// `--optimize-size`, so they are instantiated once per concrete type and
+// allocator rather than once per interface.
+template <typename T, typename Allocator>
+struct protocol_lifetime {
+  static void* clone(void* cb, const Allocator& alloc) {
+    return protocol_storage<Allocator>::template create<T>(
+        alloc, *static_cast<const T*>(cb));
+  }
+
+  static void* move(void* cb, const Allocator& alloc) {
+    return protocol_storage<Allocator>::template create<T>(
+        alloc, std::move(*static_cast<T*>(cb)));
+  }
+
+  static void destroy(void* cb, const Allocator& alloc) noexcept {
+    protocol_storage<Allocator>::destroy(static_cast<T*>(cb), alloc);
+  }
+};
+
+// `std::allocator` allocates by size and alignment only, so trivially copyable
+// and destructible types of the same size and alignment share one set of
+// entries. Copying and moving are a `memcpy`, which implicitly creates the
+// object in the new allocation.
+template <std::size_t Size, std::size_t Align>
+struct protocol_trivial_lifetime {
+  struct alignas(Align) storage {
+    std::byte bytes[Size];
+  };
+
+  using allocator_type = std::allocator<storage>;
+
+  static void* clone(void* cb, const std::allocator<std::byte>&) {
+    allocator_type alloc;
+    storage* mem = std::allocator_traits<allocator_type>::allocate(alloc, 1);
+    std::memcpy(mem, cb, Size);
+    return mem;
+  }
+
+  static void* move(void* cb, const std::allocator<std::byte>& alloc) {
+    return clone(cb, alloc);
+  }
+
+  static void destroy(void* cb, const std::allocator<std::byte>&) noexcept {
+    allocator_type alloc;
+    std::allocator_traits<allocator_type>::deallocate(
+        alloc, static_cast<storage*>(cb), 1);
+  }
+};
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T> &&
+           std::is_trivially_destructible_v<T>
+struct protocol_lifetime<T, std::allocator<std::byte>>
+    : protocol_trivial_lifetime<sizeof(T), alignof(T)> {};
+
+// Satisfied when `Method` is exactly the member function pointer `Target`.
+// Used to select the generated `bind` overload for a given interface method.
+template <auto Method, auto Target>
+concept same_member_function =
+    std::same_as<decltype(Method), decltype(Target)> && (Method == Target);
+
+// A non-owning callable that pairs a type-erased object pointer with a
+// function pointer already resolved from a vtable. Instances are produced by
+// the generated `bind<&T::method>()` members of `protocol` and `protocol_view`
+// so that vtable lookup can be hoisted out of loops or stored in callback
+// tables. The bound object must outlive the handle.
+template <typename Object, bool Noexcept, typename R, typename... Args>
+class bound_method_base {
+  using function_type = R (*)(Object*, vtable_parameter_t<Args>...) noexcept(
+      Noexcept);
+
+  Object* object_;
+  function_type function_;
+
+ public:
+  constexpr bound_method_base(Object* object, function_type function) noexcept
+      : object_(object), function_(function) {}
+
+  R operator()(Args... args) const noexcept(Noexcept) {
+    return function_(object_, std::forward<Args>(args)...);
+  }
+};
+
+template <typename Signature>
+class bound_method;
+
+template <typename R, typename... Args>
+class bound_method<R(Args...)>
+    : public bound_method_base<void, false, R, Args...> {
+  using bound_method_base<void, false, R, Args...>::bound_method_base;
+};
+
+template <typename R, typename... Args>
+class bound_method<R(Args...) noexcept>
+    : public bound_method_base<void, true, R, Args...> {
+  using bound_method_base<void, true, R, Args...>::bound_method_base;
+};
+
+template <typename R, typename... Args>
+class bound_method<R(Args...) const>
+    : public bound_method_base<const void, false, R, Args...> {
+  using bound_method_base<const void, false, R, Args...>::bound_method_base;
+};
+
+template <typename R, typename... Args>
+class bound_method<R(Args...) const noexcept>
+    : public bound_method_base<const void, true, R, Args...> {
+  using bound_method_base<const void, true, R, Args...>::bound_method_base;
+};
+
+// Specialize as `true` for an allocator so that protocols using it hand their
+// owned object to the active `deferred_destroyer` instead of destroying and
+// deallocating it in `~protocol`.
+template <typename Allocator>
+inline constexpr bool enable_deferred_destruction = false;
+
+// Destroys objects released by `protocol` destructors on a background thread.
+// Producers push onto a lock-free intrusive stack; the worker takes the whole
+// stack with one exchange and destroys the batch in release order.
+//
+// At most one destroyer is active at a time. While none is active, protocols
+// destroy their objects synchronously. Protocols may be destroyed concurrently
+// with the destroyer's own destruction: its destructor uninstalls it, waits
+// for producers that already found it, and then destroys anything still
+// queued.
+class deferred_destroyer {
+ public:
+  struct node {
+    node* next;
+    void (*destroy)(node* self) noexcept;
+  };
+
+  deferred_destroyer();
+  ~deferred_destroyer();
+
+  deferred_destroyer(const deferred_destroyer&) = delete;
+  deferred_destroyer& operator=(const deferred_destroyer&) = delete;
+
+  static deferred_destroyer* active() noexcept {
+    return active_.load(std::memory_order_acquire);
+  }
+
+  void push(node* n) noexcept;
+
+  // Blocks until every object queued before the call has been destroyed.
+  void flush() noexcept;
+
+  // `Allocator` is deduced from `destroy_object`, and `alloc` converts to it.
+  template <typename Allocator>
+  static void destroy(void* p, void (*destroy_object)(void*, const Allocator&),
+                      const std::type_identity_t<Allocator>& alloc) noexcept;
+
+ private:
+  template <typename Allocator>
+  struct allocator_node : node {
+    void* object;
+    void (*destroy_object)(void*, const Allocator&);
+    [[no_unique_address]] Allocator alloc;
+  };
+
+  std::size_t destroy_batch(node* batch) noexcept;
+  void run() noexcept;
+
+  static std::atomic<deferred_destroyer*> active_;
+  // Producers between loading `active_` and finishing their `push`.
+  static std::atomic<std::size_t> in_flight_;
+
+  std::atomic<node*> head_ = nullptr;
+  std::atomic<std::size_t> pushed_ = 0;
+  std::atomic<std::size_t> destroyed_ = 0;
+  std::atomic<bool> stopping_ = false;
+  node stop_node_;
+  std::thread worker_;
+};
+
+template <typename Allocator>
+void deferred_destroyer::destroy(
+    void* p, void (*destroy_object)(void*, const Allocator&),
+    const std::type_identity_t<Allocator>& alloc) noexcept {
+  using node_type = allocator_node<Allocator>;
+  using node_allocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<
+          node_type>;
+  using node_traits = std::allocator_traits<node_allocator>;
+
+  // Counting before the load keeps the destroyer alive until the push, since
+  // its destructor waits for the count to drop after uninstalling it. Both
+  // sides use seq_cst so that they cannot each miss the other's store.
+  in_flight_.fetch_add(1, std::memory_order_seq_cst);
+  deferred_destroyer* destroyer = active_.load(std::memory_order_seq_cst);
+  if (destroyer == nullptr) {
+    in_flight_.fetch_sub(1, std::memory_order_release);
+    destroy_object(p, alloc);
+    return;
+  }
+  node_allocator n_alloc(alloc);
+  node_type* n;
+  try {
+    n = node_traits::allocate(n_alloc, 1);
+  } catch (...) {
+    in_flight_.fetch_sub(1, std::memory_order_release);
+    destroy_object(p, alloc);
+    return;
+  }
+  ::new (static_cast<void*>(n)) node_type{
+      {nullptr,
+       [](node* self) noexcept {
+         auto* queued = static_cast<node_type*>(self);
+         queued->destroy_object(queued->object, queued->alloc);
+         node_allocator queued_alloc(queued->alloc);
+         queued->~node_type();
+         node_traits::deallocate(queued_alloc, queued, 1);
+       }},
+      p,
+      destroy_object,
+      alloc};
+  destroyer->push(n);
+  in_flight_.fetch_sub(1, std::memory_order_release);
 }
 
+// The process-wide arena that holds objects owned by `compact_protocol`.
+// Objects are addressed by 32-bit offsets in units of `granule` bytes from a
+// single contiguous reservation, so up to 64 GiB can be addressed. The
+// reservation is made on first allocation; call `reserve` beforehand to
+// change its size. Freed blocks are recycled by size; the reservation itself
+// is never released.
+class compact_arena {
+ public:
+  static constexpr std::size_t granule = 16;
+  static constexpr std::size_t max_alignment = 64;
+  static constexpr std::size_t default_capacity = std::size_t{1} << 28;
+
+  // Sets the capacity of the reservation. Returns false if the arena is
+  // already in use.
+  static bool reserve(std::size_t capacity);
+
+  // Throws `std::bad_alloc` when the reservation is exhausted.
+  static void* allocate(std::size_t bytes, std::size_t alignment);
+  static void deallocate(void* p, std::size_t bytes) noexcept;
+
+  static std::uint32_t offset_of(const void* p) noexcept {
+    return static_cast<std::uint32_t>(
+        (static_cast<const std::byte*>(p) - base_) / granule);
+  }
+
+  XYZ_PROTOCOL_ALWAYS_INLINE static void* address_of(
+      std::uint32_t offset) noexcept {
+    return base_ + std::size_t{offset} * granule;
+  }
+
+ private:
+  static std::byte* base_;
+};
+
+// A stateless allocator drawing from the `compact_arena`.
+template <typename T>
+struct compact_allocator {
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  static_assert(alignof(T) <= compact_arena::max_alignment);
+
+  compact_allocator() = default;
+
+  template <typename U>
+  constexpr compact_allocator(const compact_allocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(compact_arena::allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept {
+    compact_arena::deallocate(p, n * sizeof(T));
+  }
+
+  friend bool operator==(const compact_allocator&,
+                         const compact_allocator&) noexcept {
+    return true;
+  }
+};
+
+inline constexpr std::uint32_t max_compact_vtables = std::uint32_t{1} << 16;
+
+// Vtables addressed by compact protocols and views. Index 0 is reserved for
+// valueless compact protocols.
+extern const void* compact_vtables[max_compact_vtables];
+
+// Registers an owning vtable and the view vtable it embeds in consecutive
+// slots of `compact_vtables` and returns the owning slot. Registering the same
+// owning vtable again returns the existing slot. Throws `std::length_error`
+// when the table is full.
+std::uint32_t register_compact_vtables(const void* owning_vtable,
+                                       const void* view_vtable);
+
 template <typename T, typename A = std::allocator<T>>
 class protocol {
   static_assert(
@@ -153,6 +720,12 @@ class protocol {
   }
 };
 
+// Wraps a `protocol` and caches the results of const member functions selected
+// at generation time with the MEMOIZE argument of `xyz_generate_protocol`.
+// Calling any non-const member function invalidates every cache.
+template <typename T, typename A = std::allocator<T>>
+class memoized_protocol;
+
 template <typename T>
 class protocol_view {
   static_assert(
@@ -165,6 +738,181 @@ class protocol_view {
       "alongside protocol specializations.");
 };
 
+// Defers construction of a `protocol` until it is first used. The concrete
+// object is built from captured in-place constructor arguments, or from a
+// factory returning the protocol, on the first call to `get()`, `operator->`
+// or a view conversion. Once constructed, access costs a single acquire load;
+// only the first access takes a lock.
+//
+// A lazy_protocol is neither copyable nor movable. Copy or move from `get()`
+// to obtain an ordinary `protocol`.
+template <typename T, typename A = std::allocator<T>>
+class lazy_protocol {
+  using protocol_type = protocol<T, A>;
+  using allocator_traits = std::allocator_traits<A>;
+
+  struct factory_vtable {
+    void (*construct)(void* factory, void* storage, const A& alloc);
+    void (*destroy)(void* factory, const A& alloc);
+  };
+
+  // Factories with no state are not allocated; `factory_` stays null.
+  template <typename F>
+  static constexpr bool stateless_factory =
+      std::is_empty_v<F> && std::default_initializable<F>;
+
+  template <typename F>
+  static constexpr factory_vtable factory_vtable_for = {
+      [](void* factory, void* storage, const A& alloc) {
+        if constexpr (stateless_factory<F>) {
+          ::new (storage) protocol_type(F{}(alloc));
+        } else {
+          ::new (storage) protocol_type((*static_cast<F*>(factory))(alloc));
+        }
+      },
+      [](void* factory, const A& alloc) {
+        if constexpr (!stateless_factory<F>) {
+          using factory_allocator =
+              typename allocator_traits::template rebind_alloc<F>;
+          using factory_traits = std::allocator_traits<factory_allocator>;
+          factory_allocator factory_alloc(alloc);
+          F* f = static_cast<F*>(factory);
+          factory_traits::destroy(factory_alloc, f);
+          factory_traits::deallocate(factory_alloc, f, 1);
+        }
+      }};
+
+  union storage {
+    storage() noexcept {}
+    ~storage() {}
+    protocol_type value;
+  };
+
+  mutable std::atomic<bool> constructed_ = false;
+  mutable std::mutex mutex_;
+  mutable storage storage_;
+  void* factory_ = nullptr;
+  const factory_vtable* factory_vtable_;
+  [[no_unique_address]] A alloc_;
+
+  template <typename F>
+  void store_factory(F&& f) {
+    using Factory = std::decay_t<F>;
+    factory_vtable_ = &factory_vtable_for<Factory>;
+    if constexpr (!stateless_factory<Factory>) {
+      using factory_allocator =
+          typename allocator_traits::template rebind_alloc<Factory>;
+      using factory_traits = std::allocator_traits<factory_allocator>;
+      factory_allocator factory_alloc(alloc_);
+      Factory* mem = factory_traits::allocate(factory_alloc, 1);
+      try {
+        factory_traits::construct(factory_alloc, mem, std::forward<F>(f));
+      } catch (...) {
+        factory_traits::deallocate(factory_alloc, mem, 1);
+        throw;
+      }
+      factory_ = mem;
+    }
+  }
+
+  void construct() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (constructed_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    // If the factory throws, it is kept so that a later access can retry.
+    factory_vtable_->construct(factory_, &storage_.value, alloc_);
+    factory_vtable_->destroy(factory_, alloc_);
+    constructed_.store(true, std::memory_order_release);
+  }
+
+ public:
+  using allocator_type = A;
+
+  template <typename U, typename... Ts>
+    requires std::constructible_from<protocol_type, std::allocator_arg_t,
+                                     const A&, std::in_place_type_t<U>,
+                                     std::decay_t<Ts>&&...> &&
+             std::default_initializable<A>
+  explicit lazy_protocol(std::in_place_type_t<U>, Ts&&... ts)
+      : lazy_protocol(std::allocator_arg, A(), std::in_place_type<U>,
+                      std::forward<Ts>(ts)...) {}
+
+  template <typename U, typename... Ts>
+    requires std::constructible_from<protocol_type, std::allocator_arg_t,
+                                     const A&, std::in_place_type_t<U>,
+                                     std::decay_t<Ts>&&...>
+  lazy_protocol(std::allocator_arg_t, const A& alloc, std::in_place_type_t<U>,
+                Ts&&... ts)
+      : alloc_(alloc) {
+    if constexpr (sizeof...(Ts) == 0) {
+      store_factory([](const A& a) {
+        return protocol_type(std::allocator_arg, a, std::in_place_type<U>);
+      });
+    } else {
+      store_factory([... args = std::forward<Ts>(ts)](const A& a) mutable {
+        return protocol_type(std::allocator_arg, a, std::in_place_type<U>,
+                             std::move(args)...);
+      });
+    }
+  }
+
+  template <typename F>
+    requires std::same_as<std::invoke_result_t<std::decay_t<F>&>,
+                          protocol_type> &&
+             std::default_initializable<A>
+  explicit lazy_protocol(F&& factory) : alloc_() {
+    store_factory([f = std::forward<F>(factory)](const A&) mutable {
+      return std::invoke(f);
+    });
+  }
+
+  lazy_protocol(const lazy_protocol&) = delete;
+  lazy_protocol& operator=(const lazy_protocol&) = delete;
+
+  ~lazy_protocol() {
+    if (constructed_.load(std::memory_order_acquire)) {
+      storage_.value.~protocol_type();
+    } else {
+      factory_vtable_->destroy(factory_, alloc_);
+    }
+  }
+
+  bool constructed() const noexcept {
+    return constructed_.load(std::memory_order_acquire);
+  }
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  protocol_type& get() {
+    if (!constructed_.load(std::memory_order_acquire)) [[unlikely]] {
+      construct();
+    }
+    return storage_.value;
+  }
+
+  const protocol_type& get() const {
+    if (!constructed_.load(std::memory_order_acquire)) [[unlikely]] {
+      construct();
+    }
+    return storage_.value;
+  }
+
+  protocol_type& operator*() { return get(); }
+  const protocol_type& operator*() const { return get(); }
+
+  protocol_type* operator->() { return &get(); }
+  const protocol_type* operator->() const { return &get(); }
+
+  operator protocol_type&() { return get(); }
+  operator const protocol_type&() const { return get(); }
+
+  operator protocol_view<T>() { return protocol_view<T>(get()); }
+  operator protocol_view<const T>() const {
+    return protocol_view<const T>(get());
+  }
+};
+
 }  // namespace xyz
 
 #endif  // XYZ_PROTOCOL_H_
@@ -1,10 +1,31 @@
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#if defined(__linux__)
+#include <unistd.h>
+#endif
 
 #include "generated/protocol_A.h"
+#include "generated/protocol_E.h"
+#include "generated/protocol_G.h"
 #include "interface_A.h"
+#include "interface_E.h"
+#include "interface_G.h"
+#include "perf_counters.h"
 
 namespace {
 
@@ -24,6 +45,7 @@ struct ALikeToo {
 static void Direct_Call(benchmark::State& state) {
   ALike a;
   benchmark::DoNotOptimize(a);
+  xyz::PerfCounters perf_counters(state);
   for (auto _ : state) {
     benchmark::DoNotOptimize(a.name());
     benchmark::DoNotOptimize(a.count());
@@ -35,6 +57,7 @@ BENCHMARK(Direct_Call);
 static void Protocol_Call(benchmark::State& state) {
   xyz::protocol<xyz::A> p(std::in_place_type<ALike>);
   benchmark::DoNotOptimize(p);
+  xyz::PerfCounters perf_counters(state);
   for (auto _ : state) {
     benchmark::DoNotOptimize(p.name());
     benchmark::DoNotOptimize(p.count());
@@ -43,9 +66,32 @@ static void Protocol_Call(benchmark::State& state) {
 
 BENCHMARK(Protocol_Call);
 
+struct GLike {
+  std::string_view name() const noexcept { return "GLike"; }
+
+  int count() { return 42; }
+
+  int scale(int x) const { return 2 * x; }
+};
+
+// Interface G is generated with relative vtables: each call first asks the
+// vtable's lookup function for the entry.
+static void RelativeVtable_Call(benchmark::State& state) {
+  xyz::protocol<xyz::G> p(std::in_place_type<GLike>);
+  benchmark::DoNotOptimize(p);
+  xyz::PerfCounters perf_counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(p.name());
+    benchmark::DoNotOptimize(p.count());
+  }
+}
+
+BENCHMARK(RelativeVtable_Call);
+
 // Copy construction benchmarks
 static void Direct_Copy(benchmark::State& state) {
   ALike a;
+  xyz::PerfCounters perf_counters(state);
   for (auto _ : state) {
     ALike copy(a);
     benchmark::DoNotOptimize(copy);
@@ -56,6 +102,7 @@ BENCHMARK(Direct_Copy);
 
 static void Protocol_Copy(benchmark::State& state) {
   xyz::protocol<xyz::A> p(std::in_place_type<ALike>);
+  xyz::PerfCounters perf_counters(state);
   for (auto _ : state) {
     xyz::protocol<xyz::A> copy(p);
     benchmark::DoNotOptimize(copy);
@@ -67,6 +114,7 @@ BENCHMARK(Protocol_Copy);
 // Move construction/assignment benchmarks
 static void Direct_Move(benchmark::State& state) {
   ALike a;
+  xyz::PerfCounters perf_counters(state);
   for (auto _ : state) {
     ALike moved(std::move(a));
     benchmark::DoNotOptimize(moved);
@@ -79,6 +127,7 @@ BENCHMARK(Direct_Move);
 
 static void Protocol_Move(benchmark::State& state) {
   xyz::protocol<xyz::A> p(std::in_place_type<ALike>);
+  xyz::PerfCounters perf_counters(state);
   for (auto _ : state) {
     xyz::protocol<xyz::A> moved(std::move(p));
     benchmark::DoNotOptimize(moved);
@@ -93,6 +142,7 @@ BENCHMARK(Protocol_Move);
 static void Direct_Swap(benchmark::State& state) {
   ALike a1;
   ALike a2;
+  xyz::PerfCounters perf_counters(state);
   for (auto _ : state) {
     std::swap(a1, a2);
     benchmark::DoNotOptimize(a1);
@@ -105,6 +155,7 @@ BENCHMARK(Direct_Swap);
 static void Protocol_Swap(benchmark::State& state) {
   xyz::protocol<xyz::A> p1(std::in_place_type<ALike>);
   xyz::protocol<xyz::A> p2(std::in_place_type<ALike>);
+  xyz::PerfCounters perf_counters(state);
   for (auto _ : state) {
     p1.swap(p2);
     benchmark::DoNotOptimize(p1);
@@ -116,6 +167,7 @@ BENCHMARK(Protocol_Swap);
 
 // Construction and Destruction benchmarks
 static void Direct_CtorDtor(benchmark::State& state) {
+  xyz::PerfCounters perf_counters(state);
   for (auto _ : state) {
     ALike a;
     benchmark::DoNotOptimize(a);
@@ -125,6 +177,7 @@ static void Direct_CtorDtor(benchmark::State& state) {
 BENCHMARK(Direct_CtorDtor);
 
 static void Protocol_CtorDtor(benchmark::State& state) {
+  xyz::PerfCounters perf_counters(state);
   for (auto _ : state) {
     xyz::protocol<xyz::A> p(std::in_place_type<ALike>);
     benchmark::DoNotOptimize(p);
@@ -138,6 +191,7 @@ static void ProtocolView_Call(benchmark::State& state) {
   ALike alike;
   xyz::protocol_view<xyz::A> view(alike);
   benchmark::DoNotOptimize(view);
+  xyz::PerfCounters perf_counters(state);
   for (auto _ : state) {
     benchmark::DoNotOptimize(view.name());
     benchmark::DoNotOptimize(view.count());
@@ -146,10 +200,40 @@ static void ProtocolView_Call(benchmark::State& state) {
 
 BENCHMARK(ProtocolView_Call);
 
+static void ProtocolView_BoundCall(benchmark::State& state) {
+  ALike alike;
+  xyz::protocol_view<xyz::A> view(alike);
+  benchmark::DoNotOptimize(view);
+  auto name = view.bind<&xyz::A::name>();
+  auto count = view.bind<&xyz::A::count>();
+  xyz::PerfCounters perf_counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(name());
+    benchmark::DoNotOptimize(count());
+  }
+}
+
+BENCHMARK(ProtocolView_BoundCall);
+
+// Builds a view of an owning protocol for every call, as a function taking a
+// `protocol_view` parameter would.
+static void ProtocolView_FromProtocolCall(benchmark::State& state) {
+  xyz::protocol<xyz::A> p(std::in_place_type<ALike>);
+  xyz::PerfCounters perf_counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(p);
+    xyz::protocol_view<xyz::A> view(p);
+    benchmark::DoNotOptimize(view.count());
+  }
+}
+
+BENCHMARK(ProtocolView_FromProtocolCall);
+
 static void RawPointer_Call(benchmark::State& state) {
   ALike alike;
   ALike* ptr = &alike;
   benchmark::DoNotOptimize(ptr);
+  xyz::PerfCounters perf_counters(state);
   for (auto _ : state) {
     benchmark::DoNotOptimize(ptr->name());
     benchmark::DoNotOptimize(ptr->count());
@@ -168,6 +252,7 @@ static void ProtocolView_Call_Jitter(benchmark::State& state) {
   benchmark::DoNotOptimize(views);
 
   size_t i = 0;
+  xyz::PerfCounters perf_counters(state);
   for (auto _ : state) {
     auto& view = views[i & 1];
     benchmark::DoNotOptimize(view.name());
@@ -187,6 +272,7 @@ static void RawPointer_Call_Jitter(benchmark::State& state) {
   benchmark::DoNotOptimize(ptrs);
 
   size_t i = 0;
+  xyz::PerfCounters perf_counters(state);
   for (auto _ : state) {
     auto* ptr = ptrs[i & 1];
     benchmark::DoNotOptimize(ptr->name());
@@ -197,6 +283,371 @@ static void RawPointer_Call_Jitter(benchmark::State& state) {
 
 BENCHMARK(RawPointer_Call_Jitter);
 
+// Startup benchmarks: build a registry of plugins of which only a few are
+// called. `plugin_bytes` counts the plugin state that is alive at the end of
+// start-up. `rss_bytes` is the growth of the process's resident set over one
+// untimed start-up after the timed loop, with free heap memory returned to
+// the system first so that the start-up cannot reuse pages that are already
+// resident.
+struct Plugin {
+  static inline std::size_t live_bytes = 0;
+  std::vector<int> table_;
+
+  Plugin() : table_(1024, 1) { live_bytes += table_.size() * sizeof(int); }
+  Plugin(const Plugin& other) : table_(other.table_) {
+    live_bytes += table_.size() * sizeof(int);
+  }
+  ~Plugin() { live_bytes -= table_.size() * sizeof(int); }
+
+  std::string_view name() const noexcept { return "Plugin"; }
+
+  int count() { return table_[0]; }
+};
+
+constexpr int kUsedPlugins = 4;
+
+// Returns the resident set size of the process, or 0 if it is unknown.
+std::size_t resident_bytes() {
+#if defined(__linux__)
+  std::FILE* statm = std::fopen("/proc/self/statm", "r");
+  if (statm == nullptr) {
+    return 0;
+  }
+  unsigned long size = 0;
+  unsigned long resident = 0;
+  const int read = std::fscanf(statm, "%lu %lu", &size, &resident);
+  std::fclose(statm);
+  if (read != 2) {
+    return 0;
+  }
+  return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#else
+  return 0;
+#endif
+}
+
+// Reports the growth of the resident set while `start_up` runs. The result of
+// `start_up` is kept alive until the growth has been measured.
+template <typename StartUp>
+void report_rss_growth(benchmark::State& state, StartUp start_up) {
+#if defined(__GLIBC__)
+  malloc_trim(0);
+#endif
+  const std::size_t before = resident_bytes();
+  if (before == 0) {
+    return;
+  }
+  const auto registry = start_up();
+  const std::size_t after = resident_bytes();
+  state.counters["rss_bytes"] =
+      static_cast<double>(after > before ? after - before : 0);
+}
+
+std::vector<xyz::protocol<xyz::A>> start_protocols(std::size_t plugins) {
+  std::vector<xyz::protocol<xyz::A>> registry;
+  registry.reserve(plugins);
+  for (std::size_t i = 0; i < plugins; ++i) {
+    registry.emplace_back(std::in_place_type<Plugin>);
+  }
+  for (int i = 0; i < kUsedPlugins; ++i) {
+    benchmark::DoNotOptimize(registry[i].count());
+  }
+  return registry;
+}
+
+// lazy_protocol is not movable, so it cannot live in a vector.
+std::deque<xyz::lazy_protocol<xyz::A>> start_lazy_protocols(
+    std::size_t plugins) {
+  std::deque<xyz::lazy_protocol<xyz::A>> registry;
+  for (std::size_t i = 0; i < plugins; ++i) {
+    registry.emplace_back(std::in_place_type<Plugin>);
+  }
+  for (int i = 0; i < kUsedPlugins; ++i) {
+    benchmark::DoNotOptimize(registry[i]->count());
+  }
+  return registry;
+}
+
+static void Protocol_Startup(benchmark::State& state) {
+  const auto plugins = static_cast<std::size_t>(state.range(0));
+  std::size_t resident = 0;
+  xyz::PerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto registry = start_protocols(plugins);
+    resident = Plugin::live_bytes;
+  }
+  state.counters["plugin_bytes"] = static_cast<double>(resident);
+  report_rss_growth(state, [&] { return start_protocols(plugins); });
+}
+
+BENCHMARK(Protocol_Startup)->Arg(256);
+
+static void LazyProtocol_Startup(benchmark::State& state) {
+  const auto plugins = static_cast<std::size_t>(state.range(0));
+  std::size_t resident = 0;
+  xyz::PerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto registry = start_lazy_protocols(plugins);
+    resident = Plugin::live_bytes;
+  }
+  state.counters["plugin_bytes"] = static_cast<double>(resident);
+  report_rss_growth(state, [&] { return start_lazy_protocols(plugins); });
+}
+
+BENCHMARK(LazyProtocol_Startup)->Arg(256);
+
+static void LazyProtocol_Call(benchmark::State& state) {
+  xyz::lazy_protocol<xyz::A> p(std::in_place_type<ALike>);
+  benchmark::DoNotOptimize(p->count());
+  xyz::PerfCounters perf_counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(p->name());
+    benchmark::DoNotOptimize(p->count());
+  }
+}
+
+BENCHMARK(LazyProtocol_Call);
+
+// Request latency benchmarks: each request builds a large object behind a
+// protocol, uses it and releases it. `p99_ns` is the 99th percentile request
+// latency, which includes destruction unless it is deferred.
+template <typename T>
+struct DeferredAllocator : std::allocator<T> {
+  DeferredAllocator() = default;
+
+  template <typename U>
+  DeferredAllocator(const DeferredAllocator<U>&) noexcept {}
+};
+
+}  // namespace
+
+template <>
+inline constexpr bool
+    xyz::enable_deferred_destruction<DeferredAllocator<std::byte>> = true;
+
+namespace {
+
+struct Response {
+  std::vector<std::vector<int>> chunks_;
+
+  Response() : chunks_(64, std::vector<int>(1024, 1)) {}
+
+  std::string_view name() const noexcept { return "Response"; }
+
+  int count() { return chunks_[0][0]; }
+};
+
+template <typename Allocator>
+static void RunRequests(benchmark::State& state) {
+  std::vector<double> latencies;
+  xyz::PerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto start = std::chrono::steady_clock::now();
+    {
+      xyz::protocol<xyz::A, Allocator> response(std::in_place_type<Response>);
+      benchmark::DoNotOptimize(response.count());
+    }
+    auto end = std::chrono::steady_clock::now();
+    latencies.push_back(
+        std::chrono::duration<double, std::nano>(end - start).count());
+  }
+  auto p99 = latencies.begin() + latencies.size() * 99 / 100;
+  std::nth_element(latencies.begin(), p99, latencies.end());
+  state.counters["p99_ns"] = *p99;
+}
+
+static void Protocol_RequestLatency(benchmark::State& state) {
+  RunRequests<std::allocator<std::byte>>(state);
+}
+
+BENCHMARK(Protocol_RequestLatency);
+
+static void Protocol_RequestLatencyDeferredDestroy(benchmark::State& state) {
+  xyz::deferred_destroyer destroyer;
+  RunRequests<DeferredAllocator<std::byte>>(state);
+  destroyer.flush();
+}
+
+BENCHMARK(Protocol_RequestLatencyDeferredDestroy);
+
+// By-value argument benchmarks: `Block` is 256 bytes and trivially copyable,
+// so it is passed by reference through the vtable and copied only into the
+// concrete method's parameter.
+struct ELike {
+  std::size_t consume(xyz::Payload payload) { return payload.data.size(); }
+
+  std::size_t inspect(xyz::Payload payload) const {
+    return payload.data.size();
+  }
+
+  std::size_t length(std::string s) const { return s.size(); }
+
+  int scale(int x) const { return x * 2; }
+
+  int sum(xyz::Block block) const { return block.values[0]; }
+};
+
+static void Direct_CallLargeByValue(benchmark::State& state) {
+  ELike e;
+  xyz::Block block{};
+  xyz::PerfCounters perf_counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(block);
+    benchmark::DoNotOptimize(e.sum(block));
+  }
+}
+
+BENCHMARK(Direct_CallLargeByValue);
+
+static void Protocol_CallLargeByValue(benchmark::State& state) {
+  xyz::protocol<xyz::E> e(std::in_place_type<ELike>);
+  xyz::Block block{};
+  xyz::PerfCounters perf_counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(block);
+    benchmark::DoNotOptimize(e.sum(block));
+  }
+}
+
+BENCHMARK(Protocol_CallLargeByValue);
+
+static void Protocol_CallMovedString(benchmark::State& state) {
+  xyz::protocol<xyz::E> e(std::in_place_type<ELike>);
+  std::string s(256, 'x');
+  xyz::PerfCounters perf_counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(e.length(std::move(s)));
+    s.assign(256, 'x');
+  }
+}
+
+BENCHMARK(Protocol_CallMovedString);
+
+// Memory per million objects: the protocols are stored contiguously, as in a
+// large array of handles. `handle_bytes` is the size of that array and
+// `heap_bytes` the storage requested for the owned objects, both per million
+// objects. An out-of-line allocator shrinks the handles but adds a copy of the
+// allocator to every heap block.
+template <typename T, bool OutOfLine>
+struct ByteCountingAllocator {
+  std::size_t* bytes_;
+  std::size_t* allocations_;
+
+  using value_type = T;
+
+  ByteCountingAllocator(std::size_t* bytes, std::size_t* allocations)
+      : bytes_(bytes), allocations_(allocations) {}
+
+  template <typename U>
+  ByteCountingAllocator(const ByteCountingAllocator<U, OutOfLine>& other)
+      : bytes_(other.bytes_), allocations_(other.allocations_) {}
+
+  template <typename Other>
+  struct rebind {
+    using other = ByteCountingAllocator<Other, OutOfLine>;
+  };
+
+  T* allocate(std::size_t n) {
+    *bytes_ += n * sizeof(T);
+    ++*allocations_;
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T* p, std::size_t n) { std::allocator<T>{}.deallocate(p, n); }
+
+  friend bool operator==(const ByteCountingAllocator& lhs,
+                         const ByteCountingAllocator& rhs) noexcept {
+    return lhs.bytes_ == rhs.bytes_ && lhs.allocations_ == rhs.allocations_;
+  }
+};
+
+}  // namespace
+
+template <>
+inline constexpr bool xyz::enable_out_of_line_allocator<
+    ByteCountingAllocator<std::byte, true>> = true;
+
+namespace {
+
+template <bool OutOfLine>
+static void RunMemoryPerMillion(benchmark::State& state) {
+  using Allocator = ByteCountingAllocator<std::byte, OutOfLine>;
+  constexpr std::size_t kObjects = 1'000'000;
+  std::size_t heap_bytes = 0;
+  std::size_t allocations = 0;
+  xyz::PerfCounters perf_counters(state);
+  for (auto _ : state) {
+    heap_bytes = 0;
+    std::vector<xyz::protocol<xyz::A, Allocator>> objects;
+    objects.reserve(kObjects);
+    for (std::size_t i = 0; i < kObjects; ++i) {
+      objects.emplace_back(std::allocator_arg,
+                           Allocator(&heap_bytes, &allocations),
+                           std::in_place_type<ALike>);
+    }
+    int total = 0;
+    for (auto& object : objects) {
+      total += object.count();
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.counters["handle_bytes"] =
+      static_cast<double>(sizeof(xyz::protocol<xyz::A, Allocator>) * kObjects);
+  state.counters["heap_bytes"] = static_cast<double>(heap_bytes);
+}
+
+static void Protocol_MemoryPerMillionInlineAllocator(benchmark::State& state) {
+  RunMemoryPerMillion<false>(state);
+}
+
+BENCHMARK(Protocol_MemoryPerMillionInlineAllocator)
+    ->Unit(benchmark::kMillisecond);
+
+static void Protocol_MemoryPerMillionOutOfLineAllocator(
+    benchmark::State& state) {
+  RunMemoryPerMillion<true>(state);
+}
+
+BENCHMARK(Protocol_MemoryPerMillionOutOfLineAllocator)
+    ->Unit(benchmark::kMillisecond);
+
+// Scan benchmarks: call through every element of a large array of handles.
+// Compact protocols are eight bytes, so twice as many fit in a cache line.
+template <typename Handle>
+static void RunScan(benchmark::State& state) {
+  std::vector<Handle> handles;
+  handles.reserve(static_cast<std::size_t>(state.range(0)));
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    if (i % 2 == 0) {
+      handles.emplace_back(std::in_place_type<ALike>);
+    } else {
+      handles.emplace_back(std::in_place_type<ALikeToo>);
+    }
+  }
+  xyz::PerfCounters perf_counters(state);
+  for (auto _ : state) {
+    int total = 0;
+    for (auto& handle : handles) {
+      total += handle.count();
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["handle_bytes"] = sizeof(Handle);
+}
+
+static void Protocol_Scan(benchmark::State& state) {
+  RunScan<xyz::protocol<xyz::A>>(state);
+}
+
+BENCHMARK(Protocol_Scan)->Arg(1 << 16)->Arg(1 << 22);
+
+static void CompactProtocol_Scan(benchmark::State& state) {
+  RunScan<xyz::compact_protocol<xyz::A>>(state);
+}
+
+BENCHMARK(CompactProtocol_Scan)->Arg(1 << 16)->Arg(1 << 22);
+
 }  // namespace
 
 BENCHMARK_MAIN();
@@ -0,0 +1,104 @@
+// Code size of generated vtables. This file is built twice: against interfaces
+// A and A_Subset, and against interfaces H and H_Subset, which are the same
+// interfaces generated with OPTIMIZE_SIZE. Each build stores `kTypes` concrete
+// types in owning protocols of both interfaces and in unique protocols, so
+// every owning vtable entry is instantiated. `protocol_text_size_report`
+// compares the `.text` of the two builds.
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if XYZ_OPTIMIZE_SIZE
+#include "generated/protocol_H.h"
+#include "generated/protocol_H_Subset.h"
+#include "interface_H.h"
+#include "interface_H_Subset.h"
+using Interface = xyz::H;
+using Subset = xyz::H_Subset;
+#else
+#include "generated/protocol_A.h"
+#include "generated/protocol_A_Subset.h"
+#include "interface_A.h"
+#include "interface_A_Subset.h"
+using Interface = xyz::A;
+using Subset = xyz::A_Subset;
+#endif
+
+namespace {
+
+constexpr std::size_t kTypes = 128;
+
+// Trivially copyable: with OPTIMIZE_SIZE, all of these share one set of
+// lifetime entries.
+template <std::size_t I>
+struct Counter {
+  int value = static_cast<int>(I);
+
+  std::string_view name() const noexcept { return "Counter"; }
+
+  int count() { return value; }
+};
+
+template <std::size_t I>
+struct Named {
+  std::string label = std::string(32, static_cast<char>('a' + I % 26));
+
+  std::string_view name() const noexcept { return label; }
+
+  int count() { return static_cast<int>(label.size() + I); }
+};
+
+struct Registry {
+  std::vector<xyz::protocol<Interface>> protocols;
+  std::vector<xyz::protocol<Subset>> subsets;
+  std::vector<xyz::unique_protocol<Interface>> uniques;
+};
+
+template <typename T>
+void add(Registry& registry) {
+  registry.protocols.emplace_back(std::in_place_type<T>);
+  registry.subsets.emplace_back(std::in_place_type<T>);
+  registry.uniques.emplace_back(std::in_place_type<T>);
+}
+
+template <std::size_t... Is>
+Registry make_registry(std::index_sequence<Is...>) {
+  Registry registry;
+  (add<Counter<Is>>(registry), ...);
+  (add<Named<Is>>(registry), ...);
+  return registry;
+}
+
+const Registry& registry() {
+  static const auto& instance =
+      *new auto(make_registry(std::make_index_sequence<kTypes>{}));
+  return instance;
+}
+
+// Copies every owning protocol, which calls the clone and destroy entries of
+// each concrete type.
+static void CodeSize_CopyEveryType(benchmark::State& state) {
+  const auto& instances = registry();
+  for (auto _ : state) {
+    auto protocols = instances.protocols;
+    auto subsets = instances.subsets;
+    benchmark::DoNotOptimize(protocols.data());
+    benchmark::DoNotOptimize(subsets.data());
+  }
+  state.counters["types"] = static_cast<double>(2 * kTypes);
+  state.SetItemsProcessed(
+      state.iterations() *
+      static_cast<std::int64_t>(instances.protocols.size() +
+                                instances.subsets.size()));
+}
+
+BENCHMARK(CodeSize_CopyEveryType);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,264 @@
+// Iterates containers of polymorphic objects and calls `count()` on each.
+// The containers hold from 1 to 64 concrete types in one of three orders:
+// grouped by type, uniformly random, or Zipf-skewed so that a few types
+// dominate. Sizes run from 256 objects, which fit in L1, to four million,
+// which do not fit in any cache.
+//
+// Each case compares four layouts of the same objects:
+//
+// * `std::vector<xyz::protocol<xyz::A>>`: a vtable pointer in the handle and
+//   the object on the heap.
+// * `std::vector<xyz::protocol_view<xyz::A>>`: the same, without ownership.
+// * `std::vector<std::unique_ptr<ABase>>`: the vtable pointer in the object.
+// * `std::vector<std::variant<...>>`: the objects in place, dispatched by
+//   `std::visit`.
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "generated/protocol_A.h"
+#include "interface_A.h"
+#include "perf_counters.h"
+
+namespace {
+
+template <std::size_t I>
+struct ALikeN {
+  int value = static_cast<int>(I);
+
+  std::string_view name() const noexcept { return "ALikeN"; }
+
+  int count() { return value * 3 + static_cast<int>(I); }
+};
+
+struct ABase {
+  virtual ~ABase() = default;
+
+  virtual std::string_view name() const noexcept = 0;
+
+  virtual int count() = 0;
+};
+
+template <std::size_t I>
+struct VirtualALikeN final : ABase {
+  int value = static_cast<int>(I);
+
+  std::string_view name() const noexcept override { return "VirtualALikeN"; }
+
+  int count() override { return value * 3 + static_cast<int>(I); }
+};
+
+template <std::size_t... I>
+std::variant<ALikeN<I>...> MakeVariant(std::index_sequence<I...>);
+
+template <std::size_t Types>
+using VariantALike = decltype(MakeVariant(std::make_index_sequence<Types>{}));
+
+enum class Order : int64_t { kSorted, kRandom, kZipf };
+
+// Returns the type of each of `size` objects. Sorted orders hold the same
+// uniform distribution as random ones, grouped by type.
+std::vector<std::size_t> TypeIndices(std::size_t types, Order order,
+                                     std::size_t size) {
+  std::mt19937_64 engine(42);
+  std::vector<std::size_t> indices(size);
+  if (order == Order::kZipf) {
+    std::vector<double> weights(types);
+    for (std::size_t i = 0; i < types; ++i) {
+      weights[i] = 1.0 / static_cast<double>(i + 1);
+    }
+    std::discrete_distribution<std::size_t> distribution(weights.begin(),
+                                                         weights.end());
+    for (auto& index : indices) {
+      index = distribution(engine);
+    }
+  } else {
+    std::uniform_int_distribution<std::size_t> distribution(0, types - 1);
+    for (auto& index : indices) {
+      index = distribution(engine);
+    }
+    if (order == Order::kSorted) {
+      std::sort(indices.begin(), indices.end());
+    }
+  }
+  return indices;
+}
+
+template <std::size_t Types>
+struct ProtocolContainer {
+  std::vector<xyz::protocol<xyz::A>> handles;
+
+  void reserve(std::size_t size) { handles.reserve(size); }
+
+  template <std::size_t I>
+  void add() {
+    handles.emplace_back(std::in_place_type<ALikeN<I>>);
+  }
+
+  int sum() {
+    int total = 0;
+    for (auto& handle : handles) {
+      total += handle.count();
+    }
+    return total;
+  }
+
+  static constexpr std::size_t handle_bytes = sizeof(xyz::protocol<xyz::A>);
+};
+
+// The views refer to objects owned by protocols, which are reserved up front
+// so that the views stay valid.
+template <std::size_t Types>
+struct ProtocolViewContainer {
+  std::vector<xyz::protocol<xyz::A>> objects;
+  std::vector<xyz::protocol_view<xyz::A>> views;
+
+  void reserve(std::size_t size) {
+    objects.reserve(size);
+    views.reserve(size);
+  }
+
+  template <std::size_t I>
+  void add() {
+    views.emplace_back(objects.emplace_back(std::in_place_type<ALikeN<I>>));
+  }
+
+  int sum() {
+    int total = 0;
+    for (auto& view : views) {
+      total += view.count();
+    }
+    return total;
+  }
+
+  static constexpr std::size_t handle_bytes =
+      sizeof(xyz::protocol_view<xyz::A>);
+};
+
+template <std::size_t Types>
+struct VirtualContainer {
+  std::vector<std::unique_ptr<ABase>> pointers;
+
+  void reserve(std::size_t size) { pointers.reserve(size); }
+
+  template <std::size_t I>
+  void add() {
+    pointers.push_back(std::make_unique<VirtualALikeN<I>>());
+  }
+
+  int sum() {
+    int total = 0;
+    for (auto& pointer : pointers) {
+      total += pointer->count();
+    }
+    return total;
+  }
+
+  static constexpr std::size_t handle_bytes = sizeof(std::unique_ptr<ABase>);
+};
+
+template <std::size_t Types>
+struct VariantContainer {
+  std::vector<VariantALike<Types>> variants;
+
+  void reserve(std::size_t size) { variants.reserve(size); }
+
+  template <std::size_t I>
+  void add() {
+    variants.emplace_back(std::in_place_index<I>);
+  }
+
+  int sum() {
+    int total = 0;
+    for (auto& variant : variants) {
+      total += std::visit([](auto& alike) { return alike.count(); }, variant);
+    }
+    return total;
+  }
+
+  static constexpr std::size_t handle_bytes = sizeof(VariantALike<Types>);
+};
+
+template <typename Container, std::size_t... I>
+void Add(Container& container, std::size_t type, std::index_sequence<I...>) {
+  ((type == I ? (container.template add<I>(), true) : false) || ...);
+}
+
+// The arguments are the order and the number of objects.
+template <template <std::size_t> class Container, std::size_t Types>
+static void RunIterate(benchmark::State& state) {
+  const auto order = static_cast<Order>(state.range(0));
+  const auto size = static_cast<std::size_t>(state.range(1));
+  Container<Types> container;
+  container.reserve(size);
+  for (std::size_t type : TypeIndices(Types, order, size)) {
+    Add(container, type, std::make_index_sequence<Types>{});
+  }
+  xyz::PerfCounters perf_counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(container.sum());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+  state.counters["handle_bytes"] =
+      static_cast<double>(Container<Types>::handle_bytes);
+  constexpr std::string_view kOrders[] = {"sorted", "random", "zipf"};
+  state.SetLabel(std::string(kOrders[state.range(0)]));
+}
+
+static void IterateArguments(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"order", "size"})
+      ->ArgsProduct({{static_cast<int64_t>(Order::kSorted),
+                      static_cast<int64_t>(Order::kRandom),
+                      static_cast<int64_t>(Order::kZipf)},
+                     {1 << 8, 1 << 12, 1 << 16, 1 << 22}});
+}
+
+template <std::size_t Types>
+static void Protocol_Iterate(benchmark::State& state) {
+  RunIterate<ProtocolContainer, Types>(state);
+}
+
+template <std::size_t Types>
+static void ProtocolView_Iterate(benchmark::State& state) {
+  RunIterate<ProtocolViewContainer, Types>(state);
+}
+
+template <std::size_t Types>
+static void Virtual_Iterate(benchmark::State& state) {
+  RunIterate<VirtualContainer, Types>(state);
+}
+
+template <std::size_t Types>
+static void Variant_Iterate(benchmark::State& state) {
+  RunIterate<VariantContainer, Types>(state);
+}
+
+// Registers `name` for 1 to 64 concrete types.
+#define XYZ_ITERATE_BENCHMARK(name)                    \
+  BENCHMARK_TEMPLATE(name, 1)->Apply(IterateArguments);  \
+  BENCHMARK_TEMPLATE(name, 2)->Apply(IterateArguments);  \
+  BENCHMARK_TEMPLATE(name, 4)->Apply(IterateArguments);  \
+  BENCHMARK_TEMPLATE(name, 8)->Apply(IterateArguments);  \
+  BENCHMARK_TEMPLATE(name, 16)->Apply(IterateArguments); \
+  BENCHMARK_TEMPLATE(name, 32)->Apply(IterateArguments); \
+  BENCHMARK_TEMPLATE(name, 64)->Apply(IterateArguments)
+
+XYZ_ITERATE_BENCHMARK(Protocol_Iterate);
+XYZ_ITERATE_BENCHMARK(ProtocolView_Iterate);
+XYZ_ITERATE_BENCHMARK(Virtual_Iterate);
+XYZ_ITERATE_BENCHMARK(Variant_Iterate);
+
+#undef XYZ_ITERATE_BENCHMARK
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,94 @@
+/* Copyright (c) 2025 The XYZ Protocol Authors. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+==============================================================================*/
+
+// A translation unit that uses owning protocols of several interfaces with the
+// types of protocol_library_types.h. It is built against the headers of
+// `generate_protocols`, which every translation unit instantiates, and with
+// XYZ_EXTERN_TEMPLATES against the headers of `protocol_library`, whose
+// instantiations are compiled once. `protocol_extern_template_benchmark`
+// compares how long both take to compile.
+
+#include <memory>
+#include <utility>
+
+#if XYZ_EXTERN_TEMPLATES
+#include "generated/protocol_A_instantiations.h"
+#include "generated/protocol_B_instantiations.h"
+#include "generated/protocol_G_instantiations.h"
+#include "generated/protocol_H_instantiations.h"
+#else
+#include "generated/protocol_A.h"
+#include "generated/protocol_B.h"
+#include "generated/protocol_G.h"
+#include "generated/protocol_H.h"
+#endif
+#include "interface_A.h"
+#include "interface_B.h"
+#include "interface_G.h"
+#include "interface_H.h"
+#include "protocol_library_types.h"
+
+namespace {
+
+using xyz::library_types::Gauge;
+using xyz::library_types::Recorder;
+using xyz::library_types::Widget;
+
+// Constructs, copies, moves, assigns and calls an owning protocol.
+template <typename Protocol, typename T>
+int exercise() {
+  Protocol p(std::in_place_type<T>);
+  Protocol copy = p;
+  Protocol moved(std::move(copy));
+  p = moved;
+  p = std::move(moved);
+  return p.count();
+}
+
+template <typename Protocol, typename T>
+int exercise_unique() {
+  Protocol p(std::in_place_type<T>);
+  Protocol moved(std::move(p));
+  return moved.count();
+}
+
+}  // namespace
+
+int use_protocols() {
+  int total = 0;
+  total += exercise<xyz::protocol<xyz::A>, Widget>();
+  total += exercise<xyz::protocol<xyz::A>, Gauge>();
+  total += exercise<xyz::compact_protocol<xyz::A>, Widget>();
+  total += exercise<xyz::compact_protocol<xyz::A>, Gauge>();
+  total += exercise_unique<xyz::unique_protocol<xyz::A>, Widget>();
+  total += exercise_unique<xyz::unique_protocol<xyz::A>, Gauge>();
+  total += exercise<xyz::protocol<xyz::G>, Widget>();
+  total += exercise<xyz::protocol<xyz::G>, Gauge>();
+  total += exercise_unique<xyz::unique_protocol<xyz::G>, Widget>();
+  total += exercise<xyz::protocol<xyz::H>, Widget>();
+  total += exercise<xyz::protocol<xyz::H>, Gauge>();
+  total += exercise_unique<xyz::unique_protocol<xyz::H>, Gauge>();
+
+  xyz::memoized_protocol<xyz::B> b(std::in_place_type<Recorder>);
+  b.process("protocol");
+  total += static_cast<int>(b.get_results().size());
+  total += b.is_ready() ? 1 : 0;
+  return total;
+}
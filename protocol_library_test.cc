@@ -0,0 +1,113 @@
+/* Copyright (c) 2025 The XYZ Protocol Authors. All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+==============================================================================*/
+
+// Protocols generated by `xyz_add_protocol_library`. Their instantiations for
+// std::allocator, and the vtables of the types in protocol_library_types.h,
+// are declared extern and defined once in the `protocol_library` objects.
+
+#include "protocol.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "generated/protocol_A_instantiations.h"
+#include "generated/protocol_B_instantiations.h"
+#include "generated/protocol_G_instantiations.h"
+#include "generated/protocol_H_instantiations.h"
+#include "protocol_library_types.h"
+
+namespace {
+
+using xyz::library_types::Gauge;
+using xyz::library_types::Recorder;
+using xyz::library_types::Widget;
+
+// Not instantiated by the library, so its vtables are instantiated here.
+struct Local {
+  std::string_view name() const noexcept { return "local"; }
+  int count() { return 42; }
+  int scale(int x) const { return -x; }
+};
+
+TEST(ProtocolLibraryTest, CopiesAndMovesInstantiatedTypes) {
+  xyz::protocol<xyz::A> a(Widget{});
+  auto copy = a;
+  EXPECT_EQ(copy.name(), "widget");
+  EXPECT_EQ(copy.count(), 6);
+
+  xyz::protocol<xyz::A> moved(std::move(copy));
+  EXPECT_TRUE(copy.valueless_after_move());
+  EXPECT_EQ(moved.name(), "widget");
+
+  a = xyz::protocol<xyz::A>(std::in_place_type<Gauge>);
+  EXPECT_EQ(a.name(), "gauge");
+  EXPECT_EQ(a.count(), 8);
+}
+
+TEST(ProtocolLibraryTest, UniqueAndCompactProtocols) {
+  xyz::unique_protocol<xyz::A> unique(std::in_place_type<Gauge>);
+  EXPECT_EQ(unique.count(), 8);
+  auto moved = std::move(unique);
+  EXPECT_EQ(moved.count(), 9);
+
+  xyz::compact_protocol<xyz::A> compact(std::in_place_type<Widget>);
+  auto copy = compact;
+  EXPECT_EQ(copy.name(), "widget");
+  EXPECT_TRUE(copy.holds<Widget>());
+}
+
+TEST(ProtocolLibraryTest, RelativeAndSizeOptimizedVtables) {
+  xyz::protocol<xyz::G> g(std::in_place_type<Gauge>);
+  EXPECT_EQ(g.scale(3), 21);
+  auto g_copy = g;
+  EXPECT_EQ(g_copy.count(), 8);
+
+  xyz::protocol<xyz::H> h(Widget{});
+  auto h_copy = h;
+  EXPECT_EQ(h_copy.name(), "widget");
+  xyz::unique_protocol<xyz::H> unique_h(std::in_place_type<Gauge>);
+  EXPECT_EQ(unique_h.count(), 8);
+}
+
+TEST(ProtocolLibraryTest, MemoizedProtocol) {
+  xyz::memoized_protocol<xyz::B> b(std::in_place_type<Recorder>);
+  EXPECT_FALSE(b.is_ready());
+  b.process("abcd");
+  EXPECT_TRUE(b.is_ready());
+  EXPECT_EQ(b.get_results(), std::vector<int>{4});
+}
+
+TEST(ProtocolLibraryTest, TypesOutsideTheLibrary) {
+  xyz::protocol<xyz::A> a(Local{});
+  auto copy = a;
+  EXPECT_EQ(copy.count(), 42);
+
+  xyz::protocol<xyz::G> g(std::in_place_type<Local>);
+  EXPECT_EQ(g.scale(2), -2);
+
+  xyz::protocol_view<const xyz::A> view(copy);
+  EXPECT_EQ(view.name(), "local");
+}
+
+}  // namespace
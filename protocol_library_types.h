@@ -0,0 +1,39 @@
+#ifndef XYZ_PROTOCOL_LIBRARY_TYPES_H
+#define XYZ_PROTOCOL_LIBRARY_TYPES_H
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Concrete types whose protocol vtables `protocol_library` instantiates once.
+// They satisfy interfaces A, G and H, and Recorder satisfies B.
+namespace xyz::library_types {
+
+struct Widget {
+  std::string label = "widget";
+
+  std::string_view name() const noexcept { return label; }
+  int count() { return static_cast<int>(label.size()); }
+  int scale(int x) const { return 2 * x; }
+};
+
+struct Gauge {
+  int value = 7;
+
+  std::string_view name() const noexcept { return "gauge"; }
+  int count() { return ++value; }
+  int scale(int x) const { return value * x; }
+};
+
+struct Recorder {
+  std::vector<int> results;
+
+  void process(const std::string& input) {
+    results.push_back(static_cast<int>(input.size()));
+  }
+  std::vector<int> get_results() const { return results; }
+  bool is_ready() const { return !results.empty(); }
+};
+
+}  // namespace xyz::library_types
+
+#endif  // XYZ_PROTOCOL_LIBRARY_TYPES_H
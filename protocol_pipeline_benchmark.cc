@@ -0,0 +1,773 @@
+// An event-processing pipeline: a stream of events flows through parse,
+// filter, enrich and sink stages, with several implementations per stage.
+// The same pipeline is built from protocols, from classes with virtual
+// functions, from `std::function`s and from direct calls. Each benchmark
+// reports throughput, per-event latency percentiles and allocations per event.
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "generated/protocol_EventEnricher.h"
+#include "generated/protocol_EventFilter.h"
+#include "generated/protocol_EventParser.h"
+#include "generated/protocol_EventSink.h"
+#include "interface_pipeline.h"
+
+namespace {
+
+std::atomic<std::uint64_t> allocations{0};
+
+void* counted_allocate(std::size_t size, std::size_t alignment) noexcept {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  size = size == 0 ? 1 : size;
+  if (alignment <= alignof(std::max_align_t)) {
+    return std::malloc(size);
+  }
+  // `aligned_alloc` needs a size that is a multiple of the alignment.
+  return std::aligned_alloc(alignment,
+                            (size + alignment - 1) / alignment * alignment);
+}
+
+void* counted_new(std::size_t size, std::size_t alignment) {
+  if (void* p = counted_allocate(size, alignment)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+constexpr std::size_t kDefaultAlignment = alignof(std::max_align_t);
+
+}  // namespace
+
+// Counts every allocation of the process, so a benchmark can report the
+// allocations made while it processes events. Every replaceable form is
+// replaced, so over-aligned and non-throwing allocations are counted too.
+void* operator new(std::size_t size) {
+  return counted_new(size, kDefaultAlignment);
+}
+
+void* operator new[](std::size_t size) {
+  return counted_new(size, kDefaultAlignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return counted_new(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return counted_new(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return counted_allocate(size, kDefaultAlignment);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return counted_allocate(size, kDefaultAlignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+  return counted_allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+  return counted_allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete[](void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t,
+                       const std::nothrow_t&) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+using xyz::Event;
+using xyz::RawEvent;
+
+// Events per benchmark iteration, drawn in turn from `kDistinctEvents`
+// pre-generated events.
+constexpr std::size_t kEvents = 10'000'000;
+constexpr std::size_t kDistinctEvents = std::size_t{1} << 16;
+
+// Events are timed in batches, since one event takes less time than reading
+// the clock. A batch's latency is its time divided by `kLatencyBatch`.
+constexpr std::size_t kLatencyBatch = 64;
+
+constexpr std::uint32_t kSources = 3;
+constexpr std::uint32_t kRegions = 4;
+constexpr std::uint32_t kKinds = 8;
+
+// Parses an unsigned decimal number at `p` and advances past it.
+bool parse_number(const char*& p, const char* end, std::uint64_t& value) {
+  const auto [next, error] = std::from_chars(p, end, value);
+  if (error != std::errc{}) {
+    return false;
+  }
+  p = next;
+  return true;
+}
+
+// Sets the fields parsed from an event and rejects unknown kinds.
+bool set_fields(Event& event, const RawEvent& raw, std::uint64_t user,
+                std::uint64_t amount, std::uint64_t kind) {
+  if (kind >= kKinds) {
+    return false;
+  }
+  event.id = raw.id;
+  event.user = static_cast<std::uint32_t>(user);
+  event.amount = static_cast<std::int64_t>(amount);
+  event.kind = static_cast<std::uint32_t>(kind);
+  return true;
+}
+
+// Parses "u=<user> a=<amount> k=<kind>", with the keys in any order.
+struct KeyValueParser {
+  bool parse(const RawEvent& raw, Event& event) const {
+    const char* p = raw.data.data();
+    const char* end = p + raw.length;
+    std::uint64_t values[3] = {};
+    while (p + 2 < end) {
+      const char key = *p;
+      p += 2;
+      std::uint64_t value = 0;
+      if (!parse_number(p, end, value)) {
+        return false;
+      }
+      switch (key) {
+        case 'u':
+          values[0] = value;
+          break;
+        case 'a':
+          values[1] = value;
+          break;
+        case 'k':
+          values[2] = value;
+          break;
+        default:
+          return false;
+      }
+      if (p < end && *p == ' ') {
+        ++p;
+      }
+    }
+    return set_fields(event, raw, values[0], values[1], values[2]);
+  }
+};
+
+// Parses "<user>,<amount>,<kind>".
+struct CsvParser {
+  bool parse(const RawEvent& raw, Event& event) const {
+    const char* p = raw.data.data();
+    const char* end = p + raw.length;
+    std::uint64_t values[3] = {};
+    for (int i = 0; i < 3; ++i) {
+      if (!parse_number(p, end, values[i])) {
+        return false;
+      }
+      if (i < 2 && (p == end || *p++ != ',')) {
+        return false;
+      }
+    }
+    return set_fields(event, raw, values[0], values[1], values[2]);
+  }
+};
+
+// Reads a 4-byte user, an 8-byte amount and a 4-byte kind.
+struct BinaryParser {
+  bool parse(const RawEvent& raw, Event& event) const {
+    if (raw.length != 16) {
+      return false;
+    }
+    std::uint32_t user = 0;
+    std::uint64_t amount = 0;
+    std::uint32_t kind = 0;
+    std::memcpy(&user, raw.data.data(), 4);
+    std::memcpy(&amount, raw.data.data() + 4, 8);
+    std::memcpy(&kind, raw.data.data() + 12, 4);
+    return set_fields(event, raw, user, amount, kind);
+  }
+};
+
+struct MinimumAmount {
+  std::int64_t minimum;
+
+  bool accept(const Event& event) const { return event.amount >= minimum; }
+};
+
+struct KindMask {
+  std::uint32_t mask;
+
+  bool accept(const Event& event) const {
+    return ((mask >> event.kind) & 1) != 0;
+  }
+};
+
+// Drops every `modulus`-th event.
+struct Sampler {
+  std::uint64_t modulus;
+
+  bool accept(const Event& event) const { return event.id % modulus != 0; }
+};
+
+struct RegionLookup {
+  std::array<std::uint8_t, 256> regions;
+
+  RegionLookup() {
+    for (std::size_t i = 0; i < regions.size(); ++i) {
+      regions[i] = static_cast<std::uint8_t>((i * 7 + 3) % kRegions);
+    }
+  }
+
+  void enrich(Event& event) const { event.region = regions[event.user & 255]; }
+};
+
+struct Scorer {
+  std::array<std::uint32_t, kKinds> weights{1, 3, 5, 7, 11, 13, 17, 19};
+
+  void enrich(Event& event) const {
+    event.score = static_cast<std::uint32_t>(event.amount) * weights[event.kind];
+  }
+};
+
+struct SumSink {
+  std::uint64_t sum = 0;
+
+  void consume(const Event& event) {
+    sum += static_cast<std::uint64_t>(event.amount);
+  }
+
+  std::uint64_t checksum() const { return sum; }
+};
+
+struct MaxSink {
+  std::uint32_t max = 0;
+  std::uint64_t count = 0;
+
+  void consume(const Event& event) {
+    max = std::max(max, event.score);
+    ++count;
+  }
+
+  std::uint64_t checksum() const { return max ^ (count << 32); }
+};
+
+struct HistogramSink {
+  std::array<std::uint64_t, 16> buckets{};
+
+  void consume(const Event& event) { ++buckets[event.score % 16]; }
+
+  std::uint64_t checksum() const {
+    std::uint64_t result = 0;
+    for (auto bucket : buckets) {
+      result = result * 31 + bucket;
+    }
+    return result;
+  }
+};
+
+// Each pipeline has one parser per source, applies every filter and every
+// enricher, and hands the event to the sink of its region. The configuration is
+// the same for every implementation:
+//
+//   parsers:   KeyValueParser, CsvParser, BinaryParser
+//   filters:   MinimumAmount{16}, KindMask{0b1011'1011}, Sampler{7}
+//   enrichers: RegionLookup, Scorer
+//   sinks:     SumSink, MaxSink, HistogramSink, SumSink
+
+class ProtocolPipeline {
+  std::vector<xyz::protocol<xyz::EventParser>> parsers_;
+  std::vector<xyz::protocol<xyz::EventFilter>> filters_;
+  std::vector<xyz::protocol<xyz::EventEnricher>> enrichers_;
+  std::vector<xyz::protocol<xyz::EventSink>> sinks_;
+
+ public:
+  ProtocolPipeline() {
+    parsers_.emplace_back(std::in_place_type<KeyValueParser>);
+    parsers_.emplace_back(std::in_place_type<CsvParser>);
+    parsers_.emplace_back(std::in_place_type<BinaryParser>);
+    filters_.emplace_back(std::in_place_type<MinimumAmount>, 16);
+    filters_.emplace_back(std::in_place_type<KindMask>, 0b1011'1011u);
+    filters_.emplace_back(std::in_place_type<Sampler>, 7u);
+    enrichers_.emplace_back(std::in_place_type<RegionLookup>);
+    enrichers_.emplace_back(std::in_place_type<Scorer>);
+    sinks_.emplace_back(std::in_place_type<SumSink>);
+    sinks_.emplace_back(std::in_place_type<MaxSink>);
+    sinks_.emplace_back(std::in_place_type<HistogramSink>);
+    sinks_.emplace_back(std::in_place_type<SumSink>);
+  }
+
+  void process(const RawEvent& raw) {
+    Event event{};
+    if (!parsers_[raw.source].parse(raw, event)) {
+      return;
+    }
+    for (const auto& filter : filters_) {
+      if (!filter.accept(event)) {
+        return;
+      }
+    }
+    for (const auto& enricher : enrichers_) {
+      enricher.enrich(event);
+    }
+    sinks_[event.region].consume(event);
+  }
+
+  std::uint64_t checksum() const {
+    std::uint64_t result = 0;
+    for (const auto& sink : sinks_) {
+      result = result * 1'000'003 + sink.checksum();
+    }
+    return result;
+  }
+};
+
+struct VirtualParser {
+  virtual ~VirtualParser() = default;
+  virtual bool parse(const RawEvent& raw, Event& event) const = 0;
+};
+
+struct VirtualFilter {
+  virtual ~VirtualFilter() = default;
+  virtual bool accept(const Event& event) const = 0;
+};
+
+struct VirtualEnricher {
+  virtual ~VirtualEnricher() = default;
+  virtual void enrich(Event& event) const = 0;
+};
+
+struct VirtualSink {
+  virtual ~VirtualSink() = default;
+  virtual void consume(const Event& event) = 0;
+  virtual std::uint64_t checksum() const = 0;
+};
+
+// Derives from the abstract stage, as a class written for virtual dispatch
+// would, and forwards to the shared implementation.
+template <typename T>
+struct VirtualParserFor final : VirtualParser {
+  T impl;
+  bool parse(const RawEvent& raw, Event& event) const override {
+    return impl.parse(raw, event);
+  }
+};
+
+template <typename T>
+struct VirtualFilterFor final : VirtualFilter {
+  T impl;
+  explicit VirtualFilterFor(T t) : impl(t) {}
+  bool accept(const Event& event) const override { return impl.accept(event); }
+};
+
+template <typename T>
+struct VirtualEnricherFor final : VirtualEnricher {
+  T impl;
+  void enrich(Event& event) const override { impl.enrich(event); }
+};
+
+template <typename T>
+struct VirtualSinkFor final : VirtualSink {
+  T impl;
+  void consume(const Event& event) override { impl.consume(event); }
+  std::uint64_t checksum() const override { return impl.checksum(); }
+};
+
+class VirtualPipeline {
+  std::vector<std::unique_ptr<VirtualParser>> parsers_;
+  std::vector<std::unique_ptr<VirtualFilter>> filters_;
+  std::vector<std::unique_ptr<VirtualEnricher>> enrichers_;
+  std::vector<std::unique_ptr<VirtualSink>> sinks_;
+
+ public:
+  VirtualPipeline() {
+    parsers_.push_back(std::make_unique<VirtualParserFor<KeyValueParser>>());
+    parsers_.push_back(std::make_unique<VirtualParserFor<CsvParser>>());
+    parsers_.push_back(std::make_unique<VirtualParserFor<BinaryParser>>());
+    filters_.push_back(
+        std::make_unique<VirtualFilterFor<MinimumAmount>>(MinimumAmount{16}));
+    filters_.push_back(
+        std::make_unique<VirtualFilterFor<KindMask>>(KindMask{0b1011'1011u}));
+    filters_.push_back(
+        std::make_unique<VirtualFilterFor<Sampler>>(Sampler{7u}));
+    enrichers_.push_back(std::make_unique<VirtualEnricherFor<RegionLookup>>());
+    enrichers_.push_back(std::make_unique<VirtualEnricherFor<Scorer>>());
+    sinks_.push_back(std::make_unique<VirtualSinkFor<SumSink>>());
+    sinks_.push_back(std::make_unique<VirtualSinkFor<MaxSink>>());
+    sinks_.push_back(std::make_unique<VirtualSinkFor<HistogramSink>>());
+    sinks_.push_back(std::make_unique<VirtualSinkFor<SumSink>>());
+  }
+
+  void process(const RawEvent& raw) {
+    Event event{};
+    if (!parsers_[raw.source]->parse(raw, event)) {
+      return;
+    }
+    for (const auto& filter : filters_) {
+      if (!filter->accept(event)) {
+        return;
+      }
+    }
+    for (const auto& enricher : enrichers_) {
+      enricher->enrich(event);
+    }
+    sinks_[event.region]->consume(event);
+  }
+
+  std::uint64_t checksum() const {
+    std::uint64_t result = 0;
+    for (const auto& sink : sinks_) {
+      result = result * 1'000'003 + sink->checksum();
+    }
+    return result;
+  }
+};
+
+// Each stage is a `std::function` of its one operation. The sinks live in the
+// pipeline, and their functions refer to them.
+class FunctionPipeline {
+  SumSink sum_;
+  MaxSink max_;
+  HistogramSink histogram_;
+  SumSink sum_too_;
+  std::vector<std::function<bool(const RawEvent&, Event&)>> parsers_;
+  std::vector<std::function<bool(const Event&)>> filters_;
+  std::vector<std::function<void(Event&)>> enrichers_;
+  std::vector<std::function<void(const Event&)>> sinks_;
+
+  template <typename Sink>
+  static std::function<void(const Event&)> consume(Sink& sink) {
+    return [&sink](const Event& event) { sink.consume(event); };
+  }
+
+ public:
+  FunctionPipeline() {
+    parsers_.emplace_back([p = KeyValueParser{}](const RawEvent& raw,
+                                                 Event& event) {
+      return p.parse(raw, event);
+    });
+    parsers_.emplace_back([p = CsvParser{}](const RawEvent& raw, Event& event) {
+      return p.parse(raw, event);
+    });
+    parsers_.emplace_back([p = BinaryParser{}](const RawEvent& raw,
+                                               Event& event) {
+      return p.parse(raw, event);
+    });
+    filters_.emplace_back([f = MinimumAmount{16}](const Event& event) {
+      return f.accept(event);
+    });
+    filters_.emplace_back([f = KindMask{0b1011'1011u}](const Event& event) {
+      return f.accept(event);
+    });
+    filters_.emplace_back(
+        [f = Sampler{7u}](const Event& event) { return f.accept(event); });
+    enrichers_.emplace_back(
+        [e = RegionLookup{}](Event& event) { e.enrich(event); });
+    enrichers_.emplace_back([e = Scorer{}](Event& event) { e.enrich(event); });
+    sinks_.push_back(consume(sum_));
+    sinks_.push_back(consume(max_));
+    sinks_.push_back(consume(histogram_));
+    sinks_.push_back(consume(sum_too_));
+  }
+
+  FunctionPipeline(const FunctionPipeline&) = delete;
+  FunctionPipeline& operator=(const FunctionPipeline&) = delete;
+
+  void process(const RawEvent& raw) {
+    Event event{};
+    if (!parsers_[raw.source](raw, event)) {
+      return;
+    }
+    for (const auto& filter : filters_) {
+      if (!filter(event)) {
+        return;
+      }
+    }
+    for (const auto& enricher : enrichers_) {
+      enricher(event);
+    }
+    sinks_[event.region](event);
+  }
+
+  std::uint64_t checksum() const {
+    std::uint64_t result = 0;
+    for (std::uint64_t sink : {sum_.checksum(), max_.checksum(),
+                               histogram_.checksum(), sum_too_.checksum()}) {
+      result = result * 1'000'003 + sink;
+    }
+    return result;
+  }
+};
+
+// The stages are concrete members, and a switch selects the parser and the
+// sink, so every call is direct and can be inlined.
+class DirectPipeline {
+  KeyValueParser key_value_;
+  CsvParser csv_;
+  BinaryParser binary_;
+  MinimumAmount minimum_{16};
+  KindMask kinds_{0b1011'1011u};
+  Sampler sampler_{7u};
+  RegionLookup regions_;
+  Scorer scorer_;
+  SumSink sum_;
+  MaxSink max_;
+  HistogramSink histogram_;
+  SumSink sum_too_;
+
+ public:
+  void process(const RawEvent& raw) {
+    Event event{};
+    bool parsed = false;
+    switch (raw.source) {
+      case 0:
+        parsed = key_value_.parse(raw, event);
+        break;
+      case 1:
+        parsed = csv_.parse(raw, event);
+        break;
+      default:
+        parsed = binary_.parse(raw, event);
+        break;
+    }
+    if (!parsed || !minimum_.accept(event) || !kinds_.accept(event) ||
+        !sampler_.accept(event)) {
+      return;
+    }
+    regions_.enrich(event);
+    scorer_.enrich(event);
+    switch (event.region) {
+      case 0:
+        sum_.consume(event);
+        break;
+      case 1:
+        max_.consume(event);
+        break;
+      case 2:
+        histogram_.consume(event);
+        break;
+      default:
+        sum_too_.consume(event);
+        break;
+    }
+  }
+
+  std::uint64_t checksum() const {
+    std::uint64_t result = 0;
+    for (std::uint64_t sink : {sum_.checksum(), max_.checksum(),
+                               histogram_.checksum(), sum_too_.checksum()}) {
+      result = result * 1'000'003 + sink;
+    }
+    return result;
+  }
+};
+
+// Events from every source in random order, with one in 64 of an unknown kind.
+const std::vector<RawEvent>& raw_events() {
+  static const auto& events = *new auto([] {
+    std::mt19937_64 random(42);
+    std::vector<RawEvent> result(kDistinctEvents);
+    for (std::size_t i = 0; i < result.size(); ++i) {
+      RawEvent& raw = result[i];
+      raw.id = i;
+      raw.source = static_cast<std::uint32_t>(random() % kSources);
+      const std::uint32_t user = static_cast<std::uint32_t>(random() % 100'000);
+      const std::uint64_t amount = random() % 1'000;
+      const std::uint32_t kind =
+          random() % 64 == 0 ? kKinds : static_cast<std::uint32_t>(random() %
+                                                                    kKinds);
+      char* begin = raw.data.data();
+      char* end = begin + raw.data.size();
+      char* p = begin;
+      switch (raw.source) {
+        case 0:
+          p = std::to_chars(std::copy_n("k=", 2, p), end, kind).ptr;
+          p = std::to_chars(std::copy_n(" u=", 3, p), end, user).ptr;
+          p = std::to_chars(std::copy_n(" a=", 3, p), end, amount).ptr;
+          break;
+        case 1:
+          p = std::to_chars(p, end, user).ptr;
+          *p++ = ',';
+          p = std::to_chars(p, end, amount).ptr;
+          *p++ = ',';
+          p = std::to_chars(p, end, kind).ptr;
+          break;
+        default:
+          std::memcpy(p, &user, 4);
+          std::memcpy(p + 4, &amount, 8);
+          std::memcpy(p + 12, &kind, 4);
+          p += 16;
+          break;
+      }
+      raw.length = static_cast<std::uint32_t>(p - begin);
+    }
+    return result;
+  }());
+  return events;
+}
+
+// The sinks' checksum after `kEvents` events through the direct pipeline.
+std::uint64_t expected_checksum() {
+  static const std::uint64_t checksum = [] {
+    DirectPipeline pipeline;
+    const auto& events = raw_events();
+    for (std::size_t i = 0; i < kEvents; ++i) {
+      pipeline.process(events[i % kDistinctEvents]);
+    }
+    return pipeline.checksum();
+  }();
+  return checksum;
+}
+
+// Batch times in nanoseconds, one bucket per nanosecond up to the last, which
+// collects every longer time.
+using LatencyHistogram = std::vector<std::uint64_t>;
+constexpr std::size_t kLatencyBuckets = std::size_t{1} << 16;
+
+// Returns the time per event of the batch at `fraction` of the distribution.
+double percentile(const LatencyHistogram& histogram, double fraction) {
+  std::uint64_t total = 0;
+  for (auto count : histogram) {
+    total += count;
+  }
+  const auto rank = static_cast<std::uint64_t>(fraction * total);
+  std::uint64_t seen = 0;
+  std::size_t ns = 0;
+  for (; ns + 1 < histogram.size(); ++ns) {
+    seen += histogram[ns];
+    if (seen > rank) {
+      break;
+    }
+  }
+  return static_cast<double>(ns) / kLatencyBatch;
+}
+
+template <typename Pipeline>
+void RunPipeline(benchmark::State& state) {
+  static_assert(kEvents % kLatencyBatch == 0);
+  static_assert(kDistinctEvents % kLatencyBatch == 0);
+  using Clock = std::chrono::steady_clock;
+  const auto& events = raw_events();
+  const std::uint64_t expected = expected_checksum();
+  LatencyHistogram latencies(kLatencyBuckets);
+  std::uint64_t allocated = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto pipeline = std::make_unique<Pipeline>();
+    state.ResumeTiming();
+
+    const auto before = allocations.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < kEvents; i += kLatencyBatch) {
+      const RawEvent* batch = &events[i % kDistinctEvents];
+      const auto start = Clock::now();
+      for (std::size_t j = 0; j < kLatencyBatch; ++j) {
+        pipeline->process(batch[j]);
+      }
+      const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          Clock::now() - start)
+                          .count();
+      ++latencies[std::min<std::size_t>(static_cast<std::size_t>(ns),
+                                        latencies.size() - 1)];
+    }
+    allocated += allocations.load(std::memory_order_relaxed) - before;
+
+    state.PauseTiming();
+    if (pipeline->checksum() != expected) {
+      state.SkipWithError("the pipeline's checksum differs from direct calls");
+    }
+    pipeline.reset();
+    state.ResumeTiming();
+  }
+  const auto processed = state.iterations() * static_cast<std::int64_t>(kEvents);
+  state.SetItemsProcessed(processed);
+  // Percentiles of the mean latency of a batch. One read of the clock per
+  // batch adds `Pipeline_ClockOverhead` / `kLatencyBatch` to each.
+  state.counters["p50_ns"] = percentile(latencies, 0.5);
+  state.counters["p99_ns"] = percentile(latencies, 0.99);
+  state.counters["p999_ns"] = percentile(latencies, 0.999);
+  state.counters["allocs_per_event"] =
+      static_cast<double>(allocated) / static_cast<double>(processed);
+}
+
+static void Pipeline_Direct(benchmark::State& state) {
+  RunPipeline<DirectPipeline>(state);
+}
+
+BENCHMARK(Pipeline_Direct)->Unit(benchmark::kMillisecond);
+
+static void Pipeline_Protocol(benchmark::State& state) {
+  RunPipeline<ProtocolPipeline>(state);
+}
+
+BENCHMARK(Pipeline_Protocol)->Unit(benchmark::kMillisecond);
+
+static void Pipeline_Virtual(benchmark::State& state) {
+  RunPipeline<VirtualPipeline>(state);
+}
+
+BENCHMARK(Pipeline_Virtual)->Unit(benchmark::kMillisecond);
+
+static void Pipeline_Function(benchmark::State& state) {
+  RunPipeline<FunctionPipeline>(state);
+}
+
+BENCHMARK(Pipeline_Function)->Unit(benchmark::kMillisecond);
+
+// The read of the clock that every latency batch includes.
+static void Pipeline_ClockOverhead(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(std::chrono::steady_clock::now());
+  }
+}
+
+BENCHMARK(Pipeline_ClockOverhead);
+
+}  // namespace
+
+BENCHMARK_MAIN();
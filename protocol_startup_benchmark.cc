@@ -0,0 +1,153 @@
+// Start-up cost of generated vtables. This file is built twice: against
+// interface A, whose vtables hold one pointer per entry, and against interface
+// G, which is generated with RELATIVE_VTABLES. Each build instantiates the
+// vtables of `kTypes` concrete types and reports the dynamic relocations of the
+// executable and the memory copied on write from its own mappings.
+#include <benchmark/benchmark.h>
+#include <link.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if XYZ_RELATIVE_VTABLES
+#include "generated/protocol_G.h"
+#include "interface_G.h"
+using Interface = xyz::G;
+#else
+#include "generated/protocol_A.h"
+#include "interface_A.h"
+using Interface = xyz::A;
+#endif
+
+namespace {
+
+constexpr std::size_t kTypes = 512;
+
+template <std::size_t I>
+struct Plugin {
+  std::string_view name() const noexcept { return "Plugin"; }
+
+  int count() { return static_cast<int>(I); }
+
+  int scale(int x) const { return x * static_cast<int>(I); }
+};
+
+template <std::size_t... Is>
+std::vector<xyz::protocol<Interface>> make_plugins(
+    std::index_sequence<Is...>) {
+  std::vector<xyz::protocol<Interface>> plugins;
+  plugins.reserve(sizeof...(Is));
+  (plugins.emplace_back(std::in_place_type<Plugin<Is>>), ...);
+  return plugins;
+}
+
+// The number of entries in the REL and RELA tables of the executable, which
+// the dynamic loader applies before `main`.
+std::size_t dynamic_relocations() {
+  std::size_t count = 0;
+  dl_iterate_phdr(
+      [](dl_phdr_info* info, std::size_t, void* data) {
+        auto& result = *static_cast<std::size_t*>(data);
+        for (int i = 0; i < info->dlpi_phnum; ++i) {
+          if (info->dlpi_phdr[i].p_type != PT_DYNAMIC) {
+            continue;
+          }
+          std::size_t rela_size = 0, rela_entry = 0, rel_size = 0,
+                      rel_entry = 0;
+          for (auto* dyn = reinterpret_cast<const ElfW(Dyn)*>(
+                   info->dlpi_addr + info->dlpi_phdr[i].p_vaddr);
+               dyn->d_tag != DT_NULL; ++dyn) {
+            switch (dyn->d_tag) {
+              case DT_RELASZ:
+                rela_size = dyn->d_un.d_val;
+                break;
+              case DT_RELAENT:
+                rela_entry = dyn->d_un.d_val;
+                break;
+              case DT_RELSZ:
+                rel_size = dyn->d_un.d_val;
+                break;
+              case DT_RELENT:
+                rel_entry = dyn->d_un.d_val;
+                break;
+            }
+          }
+          result = (rela_entry ? rela_size / rela_entry : 0) +
+                   (rel_entry ? rel_size / rel_entry : 0);
+        }
+        // The executable is always reported first.
+        return 1;
+      },
+      &count);
+  return count;
+}
+
+// Memory, in KiB, that the process has copied on write from the mappings of the
+// executable. These pages cannot be shared with other processes. The
+// `Anonymous` field is used rather than `Private_Dirty`, which also counts
+// page-cache pages that have not yet been written back after linking.
+std::size_t executable_dirty_kib() {
+  std::array<char, 4096> exe{};
+  const auto length = readlink("/proc/self/exe", exe.data(), exe.size() - 1);
+  if (length <= 0) {
+    return 0;
+  }
+  const std::string_view exe_path(exe.data(), static_cast<std::size_t>(length));
+
+  std::ifstream smaps("/proc/self/smaps");
+  std::string line;
+  bool in_executable = false;
+  std::size_t dirty_kib = 0;
+  while (std::getline(smaps, line)) {
+    std::istringstream fields(line);
+    std::string first;
+    fields >> first;
+    if (first.find('-') != std::string::npos) {
+      // A mapping header: address perms offset dev inode [path].
+      std::string perms, offset, dev, inode, path;
+      fields >> perms >> offset >> dev >> inode >> path;
+      in_executable = path == exe_path;
+    } else if (in_executable && first == "Anonymous:") {
+      std::size_t kib = 0;
+      fields >> kib;
+      dirty_kib += kib;
+    }
+  }
+  return dirty_kib;
+}
+
+std::vector<xyz::protocol<Interface>>& plugins() {
+  static auto& instances =
+      *new auto(make_plugins(std::make_index_sequence<kTypes>{}));
+  return instances;
+}
+
+// Calls one method on each concrete type. The counters describe the state of
+// the process as loaded, before any narrowing conversion maps a vtable.
+static void Startup_CallEveryType(benchmark::State& state) {
+  auto& registry = plugins();
+  for (auto _ : state) {
+    for (auto& plugin : registry) {
+      benchmark::DoNotOptimize(plugin.count());
+    }
+  }
+  state.counters["types"] = static_cast<double>(registry.size());
+  state.counters["relocations"] = static_cast<double>(dynamic_relocations());
+  state.counters["dirty_kib"] = static_cast<double>(executable_dirty_kib());
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(registry.size()));
+}
+
+BENCHMARK(Startup_CallEveryType);
+
+}  // namespace
+
+BENCHMARK_MAIN();
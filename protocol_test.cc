@@ -23,6 +23,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <gtest/gtest.h>
 
 #include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <thread>
@@ -34,6 +37,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "generated/protocol_B.h"
 #include "generated/protocol_C.h"
 #include "generated/protocol_D.h"
+#include "generated/protocol_E.h"
+#include "generated/protocol_F.h"
+#include "generated/protocol_G.h"
+#include "generated/protocol_G_Subset.h"
+#include "generated/protocol_H.h"
+#include "generated/protocol_H_Subset.h"
+#include "generated/protocol_I.h"
 #include "tracking_allocator.h"
 
 namespace {
@@ -196,6 +206,63 @@ TEST(ProtocolTest, ProtocolCOverloads) {
   EXPECT_EQ(const_c.compute(std::string("A")), "AA");
 }
 
+TEST(ProtocolTest, BindMemberFunctions) {
+  xyz::protocol<xyz::A> a(std::in_place_type<ALike>, 7, "Bound");
+  auto name = a.bind<&xyz::A::name>();
+  auto count = a.bind<&xyz::A::count>();
+  static_assert(noexcept(name()));
+  static_assert(!noexcept(count()));
+  EXPECT_EQ(name(), "Bound");
+  EXPECT_EQ(count(), 7);
+  EXPECT_EQ(count(), 8);
+  EXPECT_EQ(a.count(), 9);
+}
+
+TEST(ProtocolTest, BindOverloadedMemberFunctions) {
+  xyz::protocol<xyz::C> c(std::in_place_type<CLike>);
+  auto compute_int =
+      c.bind<static_cast<int (xyz::C::*)(int)>(&xyz::C::compute)>();
+  auto compute_double =
+      c.bind<static_cast<double (xyz::C::*)(double)>(&xyz::C::compute)>();
+  const auto& const_c = c;
+  auto compute_string = const_c.bind<static_cast<std::string (xyz::C::*)(
+      const std::string&) const>(&xyz::C::compute)>();
+  EXPECT_EQ(compute_int(5), 10);
+  EXPECT_EQ(compute_double(5.0), 15.0);
+  EXPECT_EQ(compute_string("A"), "AA");
+}
+
+TEST(ProtocolTest, TypeQueries) {
+  xyz::protocol<xyz::A> a(std::in_place_type<ALike>, 42, "Held");
+  EXPECT_TRUE(a.holds<ALike>());
+  EXPECT_FALSE(a.holds<CopyCounter>());
+  ASSERT_NE(a.target<ALike>(), nullptr);
+  EXPECT_EQ(a.target<ALike>()->name(), "Held");
+  EXPECT_EQ(a.target<CopyCounter>(), nullptr);
+  EXPECT_EQ(a.target_unchecked<ALike>().count(), 42);
+  EXPECT_EQ(a.count(), 43);
+
+  const auto& const_a = a;
+  static_assert(
+      std::same_as<decltype(const_a.target<ALike>()), const ALike*>);
+  EXPECT_EQ(const_a.target_unchecked<ALike>().name(), "Held");
+
+  auto moved = std::move(a);
+  EXPECT_FALSE(a.holds<ALike>());  // NOLINT(clang-analyzer-cplusplus.Move)
+  EXPECT_EQ(a.target<ALike>(), nullptr);
+  EXPECT_TRUE(moved.holds<ALike>());
+}
+
+TEST(ProtocolTest, TypeQueriesAfterNarrowingConversion) {
+  xyz::protocol<xyz::A, std::allocator<std::byte>> a(std::in_place_type<ALike>,
+                                                     42, "Narrowed");
+  xyz::protocol<xyz::A_Subset, std::allocator<std::byte>> subset(a);
+  EXPECT_TRUE(subset.holds<ALike>());
+  EXPECT_FALSE(subset.holds<ConstALike>());
+  ASSERT_NE(subset.target<ALike>(), nullptr);
+  EXPECT_EQ(subset.target<ALike>()->count(), 42);
+}
+
 TEST(ProtocolTest, CountAllocationsForInPlaceConstruction) {
   unsigned alloc_counter = 0;
   unsigned dealloc_counter = 0;
@@ -620,6 +687,51 @@ TEST(ProtocolViewTest, ViewConstnessRouting) {
   EXPECT_EQ(results[0], 15);
 }
 
+TEST(ProtocolViewTest, ViewBindMemberFunctions) {
+  BLike b;
+  xyz::protocol_view<xyz::B> view(b);
+  auto process = view.bind<&xyz::B::process>();
+  auto is_ready = view.bind<&xyz::B::is_ready>();
+  EXPECT_FALSE(is_ready());
+  for (int i = 0; i < 3; ++i) {
+    process("bound");
+  }
+  EXPECT_TRUE(is_ready());
+  EXPECT_EQ(view.get_results().size(), 3u);
+
+  xyz::protocol_view<const xyz::B> const_view(view);
+  auto get_results = const_view.bind<&xyz::B::get_results>();
+  EXPECT_EQ(get_results(), std::vector<int>({5, 5, 5}));
+}
+
+TEST(ProtocolViewTest, ViewTypeQueries) {
+  ALike a(7, "Viewed");
+  xyz::protocol_view<xyz::A> view(a);
+  EXPECT_TRUE(view.holds<ALike>());
+  EXPECT_FALSE(view.holds<CopyCounter>());
+  EXPECT_EQ(view.target<ALike>(), &a);
+  EXPECT_EQ(view.target<CopyCounter>(), nullptr);
+  EXPECT_EQ(&view.target_unchecked<ALike>(), &a);
+
+  xyz::protocol_view<const xyz::A> const_view(view);
+  EXPECT_TRUE(const_view.holds<ALike>());
+  EXPECT_FALSE(const_view.holds<ConstALike>());
+  static_assert(
+      std::same_as<decltype(const_view.target<ALike>()), const ALike*>);
+  EXPECT_EQ(const_view.target<ALike>(), &a);
+
+  const ConstALike const_alike;
+  xyz::protocol_view<const xyz::A> const_alike_view(const_alike);
+  EXPECT_TRUE(const_alike_view.holds<ConstALike>());
+  EXPECT_EQ(const_alike_view.target<ALike>(), nullptr);
+
+  xyz::protocol_view<xyz::A_Subset> subset_view(view);
+  EXPECT_TRUE(subset_view.holds<ALike>());
+  EXPECT_EQ(subset_view.target<ALike>(), &a);
+  xyz::protocol_view<const xyz::A_Subset> const_subset_view(const_view);
+  EXPECT_EQ(const_subset_view.target<ALike>(), &a);
+}
+
 TEST(ProtocolViewTest, ViewCopiesAreShallow) {
   int copies = 0;
   CopyCounter c(&copies);
@@ -1192,6 +1304,24 @@ TEST(ProtocolViewTest, NarrowingConversionCombinations) {
   EXPECT_EQ(const_view_subset2.name(), "ALike");
 }
 
+TEST(ProtocolViewTest, ViewsOfNarrowedProtocol) {
+  // The mapped owning vtable embeds the mapped view vtable, so views of a
+  // narrowed protocol dispatch through the owning vtable's own entries.
+  xyz::protocol<xyz::A, std::allocator<std::byte>> p(std::in_place_type<ALike>,
+                                                     42, "narrowed");
+  xyz::protocol<xyz::A_Subset, std::allocator<std::byte>> p_subset =
+      std::move(p);
+
+  xyz::protocol_view<xyz::A_Subset> view(p_subset);
+  EXPECT_EQ(view.name(), "narrowed");
+  EXPECT_TRUE(view.holds<ALike>());
+
+  xyz::protocol_view<const xyz::A_Subset> const_view(p_subset);
+  EXPECT_EQ(const_view.name(), "narrowed");
+  EXPECT_TRUE(const_view.holds<ALike>());
+  EXPECT_EQ(const_view.target<ALike>(), p_subset.target<ALike>());
+}
+
 TEST(ProtocolTest, NarrowingConversionConcurrentAccess) {
   constexpr int kNumThreads = 10;
   std::vector<std::thread> threads;
@@ -1277,4 +1407,1264 @@ TEST(ProtocolTest, NarrowingConversionConcurrentStressing) {
   }
 }
 
+class CountingBLike {
+  int* calls_;
+  std::vector<int> results_;
+
+ public:
+  explicit CountingBLike(int* calls) : calls_(calls) {}
+
+  void process(const std::string& input) {
+    results_.push_back(static_cast<int>(input.length()));
+  }
+
+  std::vector<int> get_results() const {
+    ++*calls_;
+    return results_;
+  }
+
+  bool is_ready() const { return !results_.empty(); }
+};
+
+class CountingCLike {
+  int* calls_;
+
+ public:
+  explicit CountingCLike(int* calls) : calls_(calls) {}
+
+  int compute(int x) { return x * 2; }
+
+  double compute(double x) { return x * 3.0; }
+
+  std::string compute(const std::string& x) const {
+    ++*calls_;
+    return x + x;
+  }
+};
+
+TEST(MemoizedProtocolTest, CachesConstResults) {
+  int calls = 0;
+  xyz::memoized_protocol<xyz::B> b(std::in_place_type<CountingBLike>, &calls);
+  EXPECT_TRUE(b.get_results().empty());
+  EXPECT_TRUE(b.get_results().empty());
+  EXPECT_EQ(calls, 1);
+  EXPECT_FALSE(b.is_ready());
+}
+
+TEST(MemoizedProtocolTest, NonConstCallInvalidates) {
+  int calls = 0;
+  xyz::memoized_protocol<xyz::B> b(std::in_place_type<CountingBLike>, &calls);
+  EXPECT_FALSE(b.is_ready());
+  EXPECT_TRUE(b.get_results().empty());
+  b.process("abc");
+  EXPECT_TRUE(b.is_ready());
+  EXPECT_EQ(b.get_results(), std::vector<int>{3});
+  EXPECT_EQ(b.get_results(), std::vector<int>{3});
+  EXPECT_EQ(calls, 2);
+  b.invalidate();
+  EXPECT_EQ(b.get_results(), std::vector<int>{3});
+  EXPECT_EQ(calls, 3);
+}
+
+TEST(MemoizedProtocolTest, CachesByArguments) {
+  int calls = 0;
+  xyz::memoized_protocol<xyz::C> c(std::in_place_type<CountingCLike>, &calls);
+  EXPECT_EQ(c.compute(std::string("ab")), "abab");
+  EXPECT_EQ(c.compute(std::string("ab")), "abab");
+  EXPECT_EQ(c.compute(std::string("x")), "xx");
+  EXPECT_EQ(calls, 2);
+  EXPECT_EQ(c.compute(4), 8);
+  EXPECT_EQ(c.compute(std::string("ab")), "abab");
+  EXPECT_EQ(calls, 3);
+}
+
+TEST(MemoizedProtocolTest, CopyKeepsCaches) {
+  int calls = 0;
+  xyz::memoized_protocol<xyz::C> c(std::in_place_type<CountingCLike>, &calls);
+  EXPECT_EQ(c.compute(std::string("ab")), "abab");
+  xyz::memoized_protocol<xyz::C> copy(c);
+  EXPECT_EQ(copy.compute(std::string("ab")), "abab");
+  EXPECT_EQ(calls, 1);
+  EXPECT_EQ(copy.underlying().compute(std::string("ab")), "abab");
+  EXPECT_EQ(calls, 2);
+}
+
+TEST(MemoizedProtocolTest, CachesUseProtocolAllocator) {
+  unsigned alloc_counter = 0;
+  unsigned dealloc_counter = 0;
+  int calls = 0;
+  {
+    xyz::memoized_protocol<xyz::C, xyz::TrackingAllocator<std::byte>> c(
+        std::allocator_arg,
+        xyz::TrackingAllocator<std::byte>(&alloc_counter, &dealloc_counter),
+        std::in_place_type<CountingCLike>, &calls);
+    EXPECT_EQ(alloc_counter, 1);
+    EXPECT_EQ(c.compute(std::string("ab")), "abab");
+    EXPECT_EQ(alloc_counter, 2);
+    EXPECT_EQ(c.compute(std::string("ab")), "abab");
+    EXPECT_EQ(alloc_counter, 2);
+  }
+  EXPECT_EQ(dealloc_counter, 2);
+}
+
+class ConstructionCountingALike {
+  int* constructions_;
+
+ public:
+  explicit ConstructionCountingALike(int* constructions)
+      : constructions_(constructions) {
+    ++*constructions_;
+  }
+
+  ConstructionCountingALike(const ConstructionCountingALike& other)
+      : constructions_(other.constructions_) {
+    ++*constructions_;
+  }
+
+  std::string_view name() const noexcept { return "Counting"; }
+
+  int count() { return *constructions_; }
+};
+
+TEST(LazyProtocolTest, ConstructsOnFirstCall) {
+  int constructions = 0;
+  xyz::lazy_protocol<xyz::A> lazy(
+      std::in_place_type<ConstructionCountingALike>, &constructions);
+  EXPECT_FALSE(lazy.constructed());
+  EXPECT_EQ(constructions, 0);
+  EXPECT_EQ(lazy->name(), "Counting");
+  EXPECT_TRUE(lazy.constructed());
+  EXPECT_EQ(lazy->count(), 1);
+  EXPECT_EQ(constructions, 1);
+}
+
+TEST(LazyProtocolTest, ConstructsOnViewCreation) {
+  int constructions = 0;
+  xyz::lazy_protocol<xyz::A> lazy(
+      std::in_place_type<ConstructionCountingALike>, &constructions);
+  xyz::protocol_view<xyz::A> view = lazy;
+  EXPECT_EQ(constructions, 1);
+  EXPECT_EQ(view.count(), 1);
+
+  const auto& const_lazy = lazy;
+  xyz::protocol_view<const xyz::A> const_view = const_lazy;
+  EXPECT_EQ(const_view.name(), "Counting");
+  EXPECT_EQ(constructions, 1);
+}
+
+TEST(LazyProtocolTest, NeverUsedIsNeverConstructed) {
+  unsigned alloc_counter = 0;
+  unsigned dealloc_counter = 0;
+  int constructions = 0;
+  {
+    xyz::lazy_protocol<xyz::A, xyz::TrackingAllocator<std::byte>> lazy(
+        std::allocator_arg,
+        xyz::TrackingAllocator<std::byte>(&alloc_counter, &dealloc_counter),
+        std::in_place_type<ConstructionCountingALike>, &constructions);
+    // Only the captured arguments are allocated.
+    EXPECT_EQ(alloc_counter, 1);
+  }
+  EXPECT_EQ(constructions, 0);
+  EXPECT_EQ(alloc_counter, 1);
+  EXPECT_EQ(dealloc_counter, 1);
+}
+
+TEST(LazyProtocolTest, NoArgumentsAllocatesNothingUntilUsed) {
+  unsigned alloc_counter = 0;
+  unsigned dealloc_counter = 0;
+  {
+    xyz::lazy_protocol<xyz::A, xyz::TrackingAllocator<std::byte>> lazy(
+        std::allocator_arg,
+        xyz::TrackingAllocator<std::byte>(&alloc_counter, &dealloc_counter),
+        std::in_place_type<ALike>);
+    EXPECT_EQ(alloc_counter, 0);
+    EXPECT_EQ(lazy->count(), 42);
+    EXPECT_EQ(alloc_counter, 1);
+  }
+  EXPECT_EQ(dealloc_counter, 1);
+}
+
+TEST(LazyProtocolTest, Factory) {
+  int calls = 0;
+  xyz::lazy_protocol<xyz::A> lazy([&calls] {
+    ++calls;
+    return xyz::protocol<xyz::A>(std::in_place_type<ALike>, 7);
+  });
+  EXPECT_EQ(calls, 0);
+  EXPECT_EQ(lazy->count(), 7);
+  EXPECT_EQ(lazy->count(), 8);
+  EXPECT_EQ(calls, 1);
+}
+
+TEST(LazyProtocolTest, FactoryThrowsAndRetries) {
+  int attempts = 0;
+  xyz::lazy_protocol<xyz::A> lazy([&attempts] {
+    if (++attempts == 1) {
+      throw std::runtime_error("first attempt fails");
+    }
+    return xyz::protocol<xyz::A>(std::in_place_type<ALike>);
+  });
+  EXPECT_THROW(lazy.get(), std::runtime_error);
+  EXPECT_FALSE(lazy.constructed());
+  EXPECT_EQ(lazy->name(), "ALike");
+  EXPECT_EQ(attempts, 2);
+}
+
+TEST(LazyProtocolTest, ConvertsToProtocol) {
+  int constructions = 0;
+  xyz::lazy_protocol<xyz::A> lazy(
+      std::in_place_type<ConstructionCountingALike>, &constructions);
+  xyz::protocol<xyz::A> copy = lazy;
+  EXPECT_EQ(constructions, 2);
+  xyz::protocol<xyz::A> moved = std::move(lazy.get());
+  EXPECT_EQ(constructions, 2);
+  EXPECT_TRUE(lazy->valueless_after_move());
+  EXPECT_EQ(moved.name(), "Counting");
+}
+
+TEST(LazyProtocolTest, ConcurrentFirstUseConstructsOnce) {
+  constexpr int kNumThreads = 16;
+  std::atomic<int> constructions = 0;
+  xyz::lazy_protocol<xyz::A> lazy([&constructions] {
+    ++constructions;
+    return xyz::protocol<xyz::A>(std::in_place_type<ALike>);
+  });
+  std::atomic<bool> start_signal{false};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&] {
+      while (!start_signal.load()) {
+        std::this_thread::yield();
+      }
+      EXPECT_EQ(lazy->name(), "ALike");
+    });
+  }
+  start_signal.store(true);
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(constructions.load(), 1);
+}
+
+template <typename T>
+struct DeferredTrackingAllocator : xyz::TrackingAllocator<T> {
+  using xyz::TrackingAllocator<T>::TrackingAllocator;
+
+  template <typename Other>
+  struct rebind {
+    using other = DeferredTrackingAllocator<Other>;
+  };
+};
+
+template <typename T>
+struct DeferredAllocator : std::allocator<T> {
+  DeferredAllocator() = default;
+
+  template <typename U>
+  DeferredAllocator(const DeferredAllocator<U>&) noexcept {}
+};
+
+}  // namespace
+
+template <>
+inline constexpr bool
+    xyz::enable_deferred_destruction<DeferredTrackingAllocator<std::byte>> =
+        true;
+
+template <>
+inline constexpr bool
+    xyz::enable_deferred_destruction<DeferredAllocator<std::byte>> = true;
+
+namespace {
+
+class ThreadRecordingALike {
+  std::thread::id* destroyed_on_;
+
+ public:
+  explicit ThreadRecordingALike(std::thread::id* destroyed_on)
+      : destroyed_on_(destroyed_on) {}
+
+  ThreadRecordingALike(const ThreadRecordingALike&) = default;
+
+  ~ThreadRecordingALike() { *destroyed_on_ = std::this_thread::get_id(); }
+
+  std::string_view name() const noexcept { return "ThreadRecording"; }
+
+  int count() { return 0; }
+};
+
+using DeferredProtocol =
+    xyz::protocol<xyz::A, DeferredTrackingAllocator<std::byte>>;
+
+TEST(DeferredDestroyerTest, DestroysSynchronouslyWithoutActiveDestroyer) {
+  unsigned alloc_counter = 0;
+  unsigned dealloc_counter = 0;
+  std::thread::id destroyed_on;
+  {
+    DeferredProtocol p(
+        std::allocator_arg,
+        DeferredTrackingAllocator<std::byte>(&alloc_counter, &dealloc_counter),
+        std::in_place_type<ThreadRecordingALike>, &destroyed_on);
+  }
+  EXPECT_EQ(destroyed_on, std::this_thread::get_id());
+  EXPECT_EQ(alloc_counter, 1);
+  EXPECT_EQ(dealloc_counter, 1);
+}
+
+TEST(DeferredDestroyerTest, DestroysOnBackgroundThread) {
+  unsigned alloc_counter = 0;
+  unsigned dealloc_counter = 0;
+  std::thread::id destroyed_on;
+  xyz::deferred_destroyer destroyer;
+  EXPECT_EQ(xyz::deferred_destroyer::active(), &destroyer);
+  {
+    DeferredProtocol p(
+        std::allocator_arg,
+        DeferredTrackingAllocator<std::byte>(&alloc_counter, &dealloc_counter),
+        std::in_place_type<ThreadRecordingALike>, &destroyed_on);
+  }
+  destroyer.flush();
+  EXPECT_NE(destroyed_on, std::thread::id());
+  EXPECT_NE(destroyed_on, std::this_thread::get_id());
+  // One allocation for the object and one for its queue node.
+  EXPECT_EQ(alloc_counter, 2);
+  EXPECT_EQ(dealloc_counter, 2);
+}
+
+TEST(DeferredDestroyerTest, OtherAllocatorsAreUnaffected) {
+  std::thread::id destroyed_on;
+  xyz::deferred_destroyer destroyer;
+  {
+    xyz::protocol<xyz::A> p(std::in_place_type<ThreadRecordingALike>,
+                            &destroyed_on);
+  }
+  EXPECT_EQ(destroyed_on, std::this_thread::get_id());
+}
+
+class DestructionCountingALike {
+  std::atomic<int>* destructions_;
+
+ public:
+  explicit DestructionCountingALike(std::atomic<int>* destructions)
+      : destructions_(destructions) {}
+
+  DestructionCountingALike(const DestructionCountingALike&) = default;
+
+  ~DestructionCountingALike() { ++*destructions_; }
+
+  std::string_view name() const noexcept { return "DestructionCounting"; }
+
+  int count() { return 0; }
+};
+
+TEST(DeferredDestroyerTest, DestructorDrainsQueue) {
+  constexpr int kNumThreads = 8;
+  constexpr int kObjectsPerThread = 100;
+  std::atomic<int> destructions = 0;
+  {
+    xyz::deferred_destroyer destroyer;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kNumThreads; ++i) {
+      threads.emplace_back([&destructions] {
+        for (int j = 0; j < kObjectsPerThread; ++j) {
+          xyz::protocol<xyz::A, DeferredAllocator<std::byte>> p(
+              std::in_place_type<DestructionCountingALike>, &destructions);
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+  EXPECT_EQ(xyz::deferred_destroyer::active(), nullptr);
+  EXPECT_EQ(destructions.load(), kNumThreads * kObjectsPerThread);
+}
+
+TEST(DeferredDestroyerTest, DestroyedWhileObjectsAreReleased) {
+  constexpr int kNumThreads = 4;
+  constexpr int kRounds = 20;
+  for (int round = 0; round < kRounds; ++round) {
+    std::atomic<int> destructions = 0;
+    std::atomic<int> releases = 0;
+    std::atomic<bool> stop = false;
+    std::vector<std::thread> threads;
+    auto destroyer = std::make_unique<xyz::deferred_destroyer>();
+    for (int i = 0; i < kNumThreads; ++i) {
+      threads.emplace_back([&] {
+        while (!stop.load()) {
+          {
+            xyz::protocol<xyz::A, DeferredAllocator<std::byte>> p(
+                std::in_place_type<DestructionCountingALike>, &destructions);
+          }
+          ++releases;
+        }
+      });
+    }
+    while (releases.load() < 100) {
+      std::this_thread::yield();
+    }
+    destroyer.reset();
+    EXPECT_EQ(xyz::deferred_destroyer::active(), nullptr);
+    stop.store(true);
+    for (auto& t : threads) {
+      t.join();
+    }
+    EXPECT_EQ(destructions.load(), releases.load());
+  }
+}
+
+class ELike {
+ public:
+  std::size_t consume(xyz::Payload payload) { return payload.data.size(); }
+
+  std::size_t inspect(xyz::Payload payload) const {
+    return payload.data.size();
+  }
+
+  std::size_t length(std::string s) const { return s.size(); }
+
+  int scale(int x) const { return x * 2; }
+
+  int sum(xyz::Block block) const {
+    int total = 0;
+    for (int v : block.values) {
+      total += v;
+    }
+    return total;
+  }
+};
+
+static_assert(std::is_same_v<xyz::vtable_parameter_t<int>, int>);
+static_assert(std::is_same_v<xyz::vtable_parameter_t<const std::string&>,
+                             const std::string&>);
+static_assert(
+    std::is_same_v<xyz::vtable_parameter_t<std::string>, std::string&&>);
+static_assert(
+    std::is_same_v<xyz::vtable_parameter_t<xyz::Payload>, xyz::Payload&&>);
+static_assert(
+    std::is_same_v<xyz::vtable_parameter_t<xyz::Block>, xyz::Block&&>);
+
+TEST(ParameterPassingTest, ByValueArgumentsAreMovedOnceThroughVtable) {
+  xyz::protocol<xyz::E> e(std::in_place_type<ELike>);
+  int moves = 0;
+  // A prvalue initializes the wrapper parameter directly, so the only move is
+  // into the concrete method's parameter.
+  EXPECT_EQ(e.consume(xyz::Payload({1, 2, 3}, &moves)), 3);
+  EXPECT_EQ(moves, 1);
+  moves = 0;
+  xyz::Payload payload({1, 2}, &moves);
+  EXPECT_EQ(e.inspect(std::move(payload)), 2);
+  EXPECT_EQ(moves, 2);
+  EXPECT_EQ(e.length("abc"), 3);
+  EXPECT_EQ(e.scale(4), 8);
+  EXPECT_EQ(e.sum(xyz::Block{{1, 2, 3}}), 6);
+}
+
+TEST(ParameterPassingTest, ViewsForwardByValueArguments) {
+  ELike impl;
+  xyz::protocol_view<xyz::E> view(impl);
+  xyz::protocol_view<const xyz::E> const_view(impl);
+  int moves = 0;
+  xyz::Payload payload({1, 2}, &moves);
+  EXPECT_EQ(view.consume(std::move(payload)), 2);
+  EXPECT_EQ(moves, 2);
+  moves = 0;
+  xyz::Payload other({1}, &moves);
+  EXPECT_EQ(const_view.inspect(std::move(other)), 1);
+  EXPECT_EQ(moves, 2);
+}
+
+TEST(ParameterPassingTest, BoundMethodForwardsByValueArguments) {
+  ELike impl;
+  xyz::protocol_view<xyz::E> view(impl);
+  auto consume = view.bind<&xyz::E::consume>();
+  int moves = 0;
+  xyz::Payload payload({1, 2, 3, 4}, &moves);
+  EXPECT_EQ(consume(std::move(payload)), 4);
+  EXPECT_EQ(moves, 2);
+}
+
+class SinkLike {
+  std::vector<int> values_;
+
+ public:
+  void push(int x) & { values_.push_back(x); }
+
+  std::size_t size() const& { return values_.size(); }
+
+  std::vector<int> take() && { return std::move(values_); }
+
+  const int* data() const { return values_.data(); }
+};
+
+struct LvalueOnlySink {
+  void push(int) & {}
+
+  std::size_t size() const& { return 0; }
+
+  std::vector<int> take() & { return {}; }
+};
+
+static_assert(xyz::protocol_concept_F<SinkLike>);
+static_assert(!xyz::protocol_concept_F<LvalueOnlySink>);
+
+TEST(RefQualifiedMethodsTest, ProtocolMovesStateOut) {
+  xyz::protocol<xyz::F> sink(std::in_place_type<SinkLike>);
+  sink.push(1);
+  sink.push(2);
+  EXPECT_EQ(sink.size(), 2);
+  const int* buffer = sink.target<SinkLike>()->data();
+  std::vector<int> values = std::move(sink).take();
+  EXPECT_EQ(values, (std::vector<int>{1, 2}));
+  // The buffer is moved out of the erased object rather than copied.
+  EXPECT_EQ(values.data(), buffer);
+  EXPECT_EQ(sink.size(), 0);
+}
+
+TEST(RefQualifiedMethodsTest, ViewMovesStateOut) {
+  SinkLike impl;
+  xyz::protocol_view<xyz::F> view(impl);
+  view.push(3);
+  const int* buffer = impl.data();
+  std::vector<int> values = std::move(view).take();
+  EXPECT_EQ(values, std::vector<int>{3});
+  EXPECT_EQ(values.data(), buffer);
+  xyz::protocol_view<const xyz::F> const_view(impl);
+  EXPECT_EQ(const_view.size(), 0);
+}
+
+TEST(RefQualifiedMethodsTest, BindRefQualifiedMethods) {
+  xyz::protocol<xyz::F> sink(std::in_place_type<SinkLike>);
+  auto push = sink.bind<&xyz::F::push>();
+  push(4);
+  push(5);
+  auto take = sink.bind<&xyz::F::take>();
+  EXPECT_EQ(take(), (std::vector<int>{4, 5}));
+  EXPECT_EQ(sink.size(), 0);
+}
+
+class MoveOnlyALike {
+  std::unique_ptr<int> count_;
+
+ public:
+  explicit MoveOnlyALike(int count) : count_(std::make_unique<int>(count)) {}
+
+  std::string_view name() const noexcept { return "MoveOnlyALike"; }
+
+  int count() { return (*count_)++; }
+};
+
+static_assert(!std::copy_constructible<MoveOnlyALike>);
+static_assert(!std::copy_constructible<xyz::unique_protocol<xyz::A>>);
+static_assert(
+    sizeof(xyz::unique_protocol_owning_vtable_traits<
+           xyz::A, std::allocator<xyz::A>>::vtable) +
+        sizeof(void*) ==
+    sizeof(xyz::protocol_owning_vtable_traits<xyz::A,
+                                              std::allocator<xyz::A>>::vtable));
+
+TEST(UniqueProtocolTest, HoldsMoveOnlyType) {
+  xyz::unique_protocol<xyz::A> a(std::in_place_type<MoveOnlyALike>, 7);
+  EXPECT_EQ(a.name(), "MoveOnlyALike");
+  EXPECT_EQ(a.count(), 7);
+  EXPECT_EQ(a.count(), 8);
+  EXPECT_TRUE(a.holds<MoveOnlyALike>());
+  EXPECT_FALSE(a.holds<ALike>());
+}
+
+TEST(UniqueProtocolTest, TargetUnchecked) {
+  xyz::unique_protocol<xyz::A> a(std::in_place_type<MoveOnlyALike>, 7);
+  EXPECT_EQ(a.target_unchecked<MoveOnlyALike>().count(), 7);
+  EXPECT_EQ(a.count(), 8);
+
+  const auto& const_a = a;
+  static_assert(
+      std::same_as<decltype(const_a.target_unchecked<MoveOnlyALike>()),
+                   const MoveOnlyALike&>);
+  EXPECT_EQ(&const_a.target_unchecked<MoveOnlyALike>(),
+            a.target<MoveOnlyALike>());
+}
+
+TEST(UniqueProtocolTest, BindMemberFunctions) {
+  xyz::unique_protocol<xyz::A> a(std::in_place_type<MoveOnlyALike>, 7);
+  auto name = a.bind<&xyz::A::name>();
+  auto count = a.bind<&xyz::A::count>();
+  static_assert(noexcept(name()));
+  EXPECT_EQ(name(), "MoveOnlyALike");
+  EXPECT_EQ(count(), 7);
+  EXPECT_EQ(a.count(), 8);
+}
+
+TEST(UniqueProtocolTest, MoveConstructionAndAssignment) {
+  xyz::unique_protocol<xyz::A> a(std::in_place_type<MoveOnlyALike>, 1);
+  xyz::unique_protocol<xyz::A> b(std::move(a));
+  EXPECT_TRUE(a.valueless_after_move());
+  EXPECT_EQ(b.count(), 1);
+  xyz::unique_protocol<xyz::A> c(std::in_place_type<ALike>);
+  c = std::move(b);
+  EXPECT_EQ(c.name(), "MoveOnlyALike");
+  EXPECT_EQ(c.count(), 2);
+  swap(a, c);
+  EXPECT_EQ(a.count(), 3);
+  EXPECT_TRUE(c.valueless_after_move());
+}
+
+TEST(UniqueProtocolTest, CountAllocations) {
+  unsigned alloc_counter = 0;
+  unsigned dealloc_counter = 0;
+  {
+    xyz::unique_protocol<xyz::A, xyz::TrackingAllocator<std::byte>> a(
+        std::allocator_arg,
+        xyz::TrackingAllocator<std::byte>(&alloc_counter, &dealloc_counter),
+        std::in_place_type<MoveOnlyALike>, 3);
+    xyz::unique_protocol<xyz::A, xyz::TrackingAllocator<std::byte>> b(
+        std::move(a));
+    EXPECT_EQ(alloc_counter, 1);
+  }
+  EXPECT_EQ(alloc_counter, 1);
+  EXPECT_EQ(dealloc_counter, 1);
+}
+
+TEST(UniqueProtocolTest, MoveWithNonEqualAllocators) {
+  unsigned alloc_counter = 0;
+  unsigned dealloc_counter = 0;
+  {
+    using Alloc = NonEqualTrackingAllocator<std::byte>;
+    xyz::unique_protocol<xyz::A, Alloc> a(
+        std::allocator_arg, Alloc(&alloc_counter, &dealloc_counter),
+        std::in_place_type<MoveOnlyALike>, 5);
+    xyz::unique_protocol<xyz::A, Alloc> b(
+        std::allocator_arg, Alloc(&alloc_counter, &dealloc_counter),
+        std::move(a));
+    EXPECT_EQ(b.count(), 5);
+    EXPECT_EQ(alloc_counter, 2);
+  }
+  EXPECT_EQ(dealloc_counter, 2);
+}
+
+TEST(UniqueProtocolTest, NarrowingMoveConversion) {
+  xyz::unique_protocol<xyz::A, std::allocator<std::byte>> a(
+      std::in_place_type<MoveOnlyALike>, 11);
+  xyz::unique_protocol<xyz::A_Subset, std::allocator<std::byte>> subset =
+      std::move(a);
+  EXPECT_TRUE(a.valueless_after_move());
+  EXPECT_EQ(subset.name(), "MoveOnlyALike");
+  EXPECT_TRUE(subset.holds<MoveOnlyALike>());
+}
+
+TEST(UniqueProtocolTest, FromCopyableProtocol) {
+  xyz::protocol<xyz::A, std::allocator<std::byte>> p(std::in_place_type<ALike>,
+                                                     9);
+  xyz::unique_protocol<xyz::A, std::allocator<std::byte>> a = std::move(p);
+  EXPECT_TRUE(p.valueless_after_move());
+  EXPECT_EQ(a.count(), 9);
+  EXPECT_TRUE(a.holds<ALike>());
+
+  xyz::protocol<xyz::A, std::allocator<std::byte>> q(std::in_place_type<ALike>,
+                                                     4);
+  xyz::unique_protocol<xyz::A_Subset, std::allocator<std::byte>> subset =
+      std::move(q);
+  EXPECT_EQ(subset.name(), "ALike");
+}
+
+TEST(UniqueProtocolTest, Views) {
+  xyz::unique_protocol<xyz::A> a(std::in_place_type<MoveOnlyALike>, 1);
+  xyz::protocol_view<xyz::A> view(a);
+  EXPECT_EQ(view.count(), 1);
+  EXPECT_EQ(a.count(), 2);
+  const auto& const_a = a;
+  xyz::protocol_view<const xyz::A> const_view(const_a);
+  EXPECT_EQ(const_view.name(), "MoveOnlyALike");
+  xyz::protocol_view<xyz::A_Subset> subset_view(a);
+  EXPECT_EQ(subset_view.name(), "MoveOnlyALike");
+  xyz::protocol_view<const xyz::A_Subset> const_subset_view(const_a);
+  EXPECT_EQ(const_subset_view.name(), "MoveOnlyALike");
+}
+
+TEST(AdoptReleaseTest, AdoptTakesOwnershipWithoutAllocation) {
+  unsigned alloc_counter = 0;
+  unsigned dealloc_counter = 0;
+  xyz::TrackingAllocator<std::byte> alloc(&alloc_counter, &dealloc_counter);
+  {
+    using t_allocator = xyz::TrackingAllocator<ALike>;
+    t_allocator t_alloc(alloc);
+    ALike* raw = std::allocator_traits<t_allocator>::allocate(t_alloc, 1);
+    std::allocator_traits<t_allocator>::construct(t_alloc, raw, 6);
+    EXPECT_EQ(alloc_counter, 1);
+
+    xyz::protocol<xyz::A, xyz::TrackingAllocator<std::byte>> a(xyz::adopt,
+                                                               alloc, raw);
+    EXPECT_EQ(alloc_counter, 1);
+    EXPECT_EQ(a.target<ALike>(), raw);
+    EXPECT_EQ(a.count(), 6);
+  }
+  EXPECT_EQ(alloc_counter, 1);
+  EXPECT_EQ(dealloc_counter, 1);
+}
+
+TEST(AdoptReleaseTest, ReleaseAndReadopt) {
+  xyz::protocol<xyz::A, std::allocator<std::byte>> a(std::in_place_type<ALike>,
+                                                     2);
+  const ALike* held = a.target<ALike>();
+
+  EXPECT_EQ(a.release<ConstructionCountingALike>(), nullptr);
+  EXPECT_FALSE(a.valueless_after_move());
+
+  auto released = a.release<ALike>();
+  EXPECT_TRUE(a.valueless_after_move());
+  EXPECT_EQ(released.get(), held);
+  EXPECT_EQ(released->count(), 2);
+
+  xyz::protocol<xyz::A, std::allocator<std::byte>> b(
+      xyz::adopt, released.get_deleter().get_allocator(), released.release());
+  EXPECT_EQ(b.target<ALike>(), held);
+  EXPECT_EQ(b.count(), 3);
+}
+
+TEST(AdoptReleaseTest, FromUniquePtr) {
+  // `std::allocator` allocates with `::operator new`, so it is compatible with
+  // objects created by a plain `new`.
+  auto legacy = std::make_unique<MoveOnlyALike>(4);
+  MoveOnlyALike* raw = legacy.get();
+  xyz::unique_protocol<xyz::A, std::allocator<std::byte>> a(
+      xyz::adopt, std::allocator<std::byte>{}, legacy.release());
+  EXPECT_EQ(a.target<MoveOnlyALike>(), raw);
+  EXPECT_EQ(a.count(), 4);
+
+  auto released = a.release<MoveOnlyALike>();
+  EXPECT_TRUE(a.valueless_after_move());
+  EXPECT_EQ(released.get(), raw);
+  EXPECT_EQ(released->count(), 5);
+}
+
+template <typename T>
+struct OutOfLineTrackingAllocator : xyz::TrackingAllocator<T> {
+  using xyz::TrackingAllocator<T>::TrackingAllocator;
+
+  template <typename Other>
+  struct rebind {
+    using other = OutOfLineTrackingAllocator<Other>;
+  };
+};
+
+}  // namespace
+
+template <>
+inline constexpr bool xyz::enable_out_of_line_allocator<
+    OutOfLineTrackingAllocator<std::byte>> = true;
+
+namespace {
+
+using OutOfLineAlloc = OutOfLineTrackingAllocator<std::byte>;
+
+class OverAlignedALike {
+  alignas(64) int x_ = 0;
+
+ public:
+  explicit OverAlignedALike(int x) : x_(x) {}
+
+  std::string_view name() const noexcept { return "OverAlignedALike"; }
+
+  int count() { return x_++; }
+};
+
+static_assert(sizeof(xyz::protocol<xyz::A, OutOfLineAlloc>) ==
+              2 * sizeof(void*));
+static_assert(sizeof(xyz::protocol<xyz::A, xyz::TrackingAllocator<std::byte>>) >
+              2 * sizeof(void*));
+static_assert(sizeof(xyz::unique_protocol<xyz::A, OutOfLineAlloc>) ==
+              2 * sizeof(void*));
+
+TEST(OutOfLineAllocatorTest, ConstructCopyAndDestroy) {
+  unsigned alloc_counter = 0;
+  unsigned dealloc_counter = 0;
+  {
+    OutOfLineAlloc alloc(&alloc_counter, &dealloc_counter);
+    xyz::protocol<xyz::A, OutOfLineAlloc> a(std::allocator_arg, alloc,
+                                            std::in_place_type<ALike>, 3);
+    EXPECT_EQ(alloc_counter, 1);
+    EXPECT_EQ(a.get_allocator(), alloc);
+    EXPECT_EQ(a.count(), 3);
+
+    auto b = a;
+    EXPECT_EQ(alloc_counter, 2);
+    EXPECT_EQ(b.get_allocator(), alloc);
+    EXPECT_EQ(b.count(), 4);
+  }
+  EXPECT_EQ(alloc_counter, 2);
+  EXPECT_EQ(dealloc_counter, 2);
+}
+
+TEST(OutOfLineAllocatorTest, MoveAndSwapDoNotAllocate) {
+  unsigned a_alloc = 0;
+  unsigned a_dealloc = 0;
+  unsigned b_alloc = 0;
+  unsigned b_dealloc = 0;
+  {
+    xyz::protocol<xyz::A, OutOfLineAlloc> a(
+        std::allocator_arg, OutOfLineAlloc(&a_alloc, &a_dealloc),
+        std::in_place_type<ALike>, 1);
+    xyz::protocol<xyz::A, OutOfLineAlloc> b(
+        std::allocator_arg, OutOfLineAlloc(&b_alloc, &b_dealloc),
+        std::in_place_type<ALike>, 2);
+
+    xyz::protocol<xyz::A, OutOfLineAlloc> c(std::move(a));
+    EXPECT_TRUE(a.valueless_after_move());
+    EXPECT_EQ(c.get_allocator(), OutOfLineAlloc(&a_alloc, &a_dealloc));
+
+    swap(b, c);
+    EXPECT_EQ(b.count(), 1);
+    EXPECT_EQ(b.get_allocator(), OutOfLineAlloc(&a_alloc, &a_dealloc));
+    EXPECT_EQ(c.get_allocator(), OutOfLineAlloc(&b_alloc, &b_dealloc));
+
+    auto copy = a;
+    EXPECT_TRUE(copy.valueless_after_move());
+  }
+  EXPECT_EQ(a_alloc, 1);
+  EXPECT_EQ(a_dealloc, 1);
+  EXPECT_EQ(b_alloc, 1);
+  EXPECT_EQ(b_dealloc, 1);
+}
+
+TEST(OutOfLineAllocatorTest, AllocatorExtendedMoveWithDifferentAllocator) {
+  unsigned a_alloc = 0;
+  unsigned a_dealloc = 0;
+  unsigned b_alloc = 0;
+  unsigned b_dealloc = 0;
+  {
+    xyz::protocol<xyz::A, OutOfLineAlloc> a(
+        std::allocator_arg, OutOfLineAlloc(&a_alloc, &a_dealloc),
+        std::in_place_type<ALike>, 5);
+    xyz::protocol<xyz::A, OutOfLineAlloc> b(
+        std::allocator_arg, OutOfLineAlloc(&b_alloc, &b_dealloc),
+        std::move(a));
+    EXPECT_EQ(b_alloc, 1);
+    EXPECT_EQ(b.get_allocator(), OutOfLineAlloc(&b_alloc, &b_dealloc));
+    EXPECT_EQ(b.count(), 5);
+
+    xyz::protocol<xyz::A_Subset, OutOfLineAlloc> subset(
+        std::allocator_arg, OutOfLineAlloc(&a_alloc, &a_dealloc),
+        std::move(b));
+    EXPECT_TRUE(b.valueless_after_move());
+    EXPECT_EQ(subset.get_allocator(), OutOfLineAlloc(&a_alloc, &a_dealloc));
+    EXPECT_EQ(subset.name(), "ALike");
+    EXPECT_EQ(b_dealloc, 1);
+  }
+  EXPECT_EQ(a_alloc, 2);
+  EXPECT_EQ(a_dealloc, 2);
+  EXPECT_EQ(b_alloc, 1);
+  EXPECT_EQ(b_dealloc, 1);
+}
+
+TEST(OutOfLineAllocatorTest, NarrowingConversions) {
+  unsigned alloc_counter = 0;
+  unsigned dealloc_counter = 0;
+  {
+    OutOfLineAlloc alloc(&alloc_counter, &dealloc_counter);
+    xyz::protocol<xyz::A, OutOfLineAlloc> a(std::allocator_arg, alloc,
+                                            std::in_place_type<ALike>, 7);
+    xyz::protocol<xyz::A_Subset, OutOfLineAlloc> copied = a;
+    EXPECT_EQ(alloc_counter, 2);
+    EXPECT_EQ(copied.get_allocator(), alloc);
+    xyz::protocol<xyz::A_Subset, OutOfLineAlloc> moved = std::move(a);
+    EXPECT_EQ(alloc_counter, 2);
+    EXPECT_EQ(moved.name(), "ALike");
+    EXPECT_EQ(moved.get_allocator(), alloc);
+  }
+  EXPECT_EQ(dealloc_counter, 2);
+}
+
+TEST(OutOfLineAllocatorTest, OverAlignedObject) {
+  unsigned alloc_counter = 0;
+  unsigned dealloc_counter = 0;
+  {
+    OutOfLineAlloc alloc(&alloc_counter, &dealloc_counter);
+    xyz::protocol<xyz::A, OutOfLineAlloc> a(
+        std::allocator_arg, alloc, std::in_place_type<OverAlignedALike>, 9);
+    auto* held = a.target<OverAlignedALike>();
+    ASSERT_NE(held, nullptr);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(held) % 64, 0u);
+    EXPECT_EQ(a.get_allocator(), alloc);
+    EXPECT_EQ(a.count(), 9);
+  }
+  EXPECT_EQ(alloc_counter, 1);
+  EXPECT_EQ(dealloc_counter, 1);
+}
+
+TEST(OutOfLineAllocatorTest, UniqueProtocol) {
+  unsigned alloc_counter = 0;
+  unsigned dealloc_counter = 0;
+  {
+    OutOfLineAlloc alloc(&alloc_counter, &dealloc_counter);
+    xyz::unique_protocol<xyz::A, OutOfLineAlloc> a(
+        std::allocator_arg, alloc, std::in_place_type<MoveOnlyALike>, 2);
+    xyz::unique_protocol<xyz::A, OutOfLineAlloc> b(std::move(a));
+    EXPECT_EQ(b.get_allocator(), alloc);
+    EXPECT_EQ(b.count(), 2);
+  }
+  EXPECT_EQ(alloc_counter, 1);
+  EXPECT_EQ(dealloc_counter, 1);
+}
+
+static_assert(sizeof(xyz::compact_protocol<xyz::A>) == 8);
+static_assert(sizeof(xyz::compact_protocol_view<xyz::A>) == 8);
+
+TEST(CompactProtocolTest, CallsAndTypeQueries) {
+  xyz::compact_protocol<xyz::A> a(std::in_place_type<ALike>, 3);
+  EXPECT_EQ(a.name(), "ALike");
+  EXPECT_EQ(a.count(), 3);
+  EXPECT_EQ(a.count(), 4);
+  EXPECT_TRUE(a.holds<ALike>());
+  EXPECT_FALSE(a.holds<OverAlignedALike>());
+  ASSERT_NE(a.target<ALike>(), nullptr);
+  EXPECT_EQ(a.target<OverAlignedALike>(), nullptr);
+  EXPECT_EQ(&a.target_unchecked<ALike>(), a.target<ALike>());
+  EXPECT_EQ(a.target_unchecked<ALike>().count(), 5);
+
+  const auto& const_a = a;
+  static_assert(std::same_as<decltype(const_a.target_unchecked<ALike>()),
+                             const ALike&>);
+  EXPECT_EQ(const_a.target_unchecked<ALike>().name(), "ALike");
+}
+
+TEST(CompactProtocolTest, CopyMoveAndSwap) {
+  xyz::compact_protocol<xyz::A> a(std::in_place_type<ALike>, 1);
+  auto b = a;
+  EXPECT_EQ(b.count(), 1);
+  EXPECT_EQ(b.count(), 2);
+  EXPECT_EQ(a.count(), 1);
+  EXPECT_NE(a.target<ALike>(), b.target<ALike>());
+
+  xyz::compact_protocol<xyz::A> c(std::move(a));
+  EXPECT_TRUE(a.valueless_after_move());
+  EXPECT_EQ(c.count(), 2);
+
+  swap(b, c);
+  EXPECT_EQ(b.count(), 3);
+  EXPECT_EQ(c.count(), 3);
+
+  a = c;
+  EXPECT_FALSE(a.valueless_after_move());
+  EXPECT_EQ(a.count(), 4);
+}
+
+TEST(CompactProtocolTest, ReusesFreedArenaBlocks) {
+  const ALike* first = nullptr;
+  {
+    xyz::compact_protocol<xyz::A> a(std::in_place_type<ALike>, 1);
+    first = a.target<ALike>();
+  }
+  xyz::compact_protocol<xyz::A> b(std::in_place_type<ALike>, 2);
+  EXPECT_EQ(b.target<ALike>(), first);
+}
+
+TEST(CompactProtocolTest, OverAlignedObject) {
+  xyz::compact_protocol<xyz::A> a(std::in_place_type<OverAlignedALike>, 5);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(a.target<OverAlignedALike>()) % 64,
+            0u);
+  EXPECT_EQ(a.count(), 5);
+}
+
+TEST(CompactProtocolTest, View) {
+  std::vector<xyz::compact_protocol<xyz::A>> objects;
+  objects.emplace_back(std::in_place_type<ALike>, 10);
+  objects.emplace_back(std::in_place_type<OverAlignedALike>, 20);
+
+  std::vector<xyz::compact_protocol_view<xyz::A>> views(objects.begin(),
+                                                        objects.end());
+  EXPECT_EQ(views[0].name(), "ALike");
+  EXPECT_EQ(views[1].name(), "OverAlignedALike");
+  EXPECT_EQ(views[0].count(), 10);
+  EXPECT_EQ(objects[0].count(), 11);
+  EXPECT_TRUE(views[1].holds<OverAlignedALike>());
+  EXPECT_EQ(views[1].target<OverAlignedALike>(),
+            objects[1].target<OverAlignedALike>());
+  EXPECT_EQ(&views[1].target_unchecked<OverAlignedALike>(),
+            objects[1].target<OverAlignedALike>());
+}
+
+class GLike {
+  std::string name_;
+  int count_;
+
+ public:
+  GLike(std::string name, int count) : name_(std::move(name)), count_(count) {}
+
+  std::string_view name() const noexcept { return name_; }
+
+  int count() { return count_++; }
+
+  int scale(int x) const { return count_ * x; }
+};
+
+struct MoveOnlyGLike {
+  std::unique_ptr<int> value = std::make_unique<int>(7);
+
+  std::string_view name() const noexcept { return "MoveOnlyGLike"; }
+
+  int count() { return (*value)++; }
+
+  int scale(int x) const { return *value * x; }
+};
+
+// Relative vtables hold only the lookup function.
+static_assert(sizeof(xyz::const_view_vtable_G) == sizeof(void*));
+static_assert(sizeof(xyz::view_vtable_G) == sizeof(void*));
+
+TEST(RelativeVtableTest, CallsCopiesAndTypeQueries) {
+  xyz::protocol<xyz::G> g(std::in_place_type<GLike>, "g", 2);
+  EXPECT_EQ(g.name(), "g");
+  EXPECT_EQ(g.count(), 2);
+  EXPECT_EQ(g.scale(10), 30);
+  EXPECT_TRUE(g.holds<GLike>());
+
+  auto copy = g;
+  EXPECT_EQ(copy.count(), 3);
+  EXPECT_EQ(g.count(), 3);
+  EXPECT_NE(copy.target<GLike>(), g.target<GLike>());
+
+  auto moved = std::move(copy);
+  EXPECT_TRUE(copy.valueless_after_move());
+  EXPECT_EQ(moved.count(), 4);
+
+  auto bound = g.bind<&xyz::G::scale>();
+  EXPECT_EQ(bound(2), 8);
+}
+
+TEST(RelativeVtableTest, Views) {
+  GLike object("view", 1);
+  xyz::protocol_view<xyz::G> view(object);
+  EXPECT_EQ(view.count(), 1);
+  EXPECT_EQ(view.scale(3), 6);
+  EXPECT_TRUE(view.holds<GLike>());
+
+  xyz::protocol_view<const xyz::G> const_view = view;
+  EXPECT_EQ(const_view.name(), "view");
+  EXPECT_EQ(const_view.target<GLike>(), &object);
+
+  xyz::protocol<xyz::G> g(std::in_place_type<GLike>, "owned", 5);
+  xyz::protocol_view<xyz::G> owned_view(g);
+  EXPECT_EQ(owned_view.count(), 5);
+  EXPECT_EQ(g.count(), 6);
+  xyz::protocol_view<const xyz::G> owned_const_view(g);
+  EXPECT_EQ(owned_const_view.scale(2), 14);
+}
+
+TEST(RelativeVtableTest, NarrowingConversions) {
+  using Alloc = std::allocator<std::byte>;
+  xyz::protocol<xyz::G, Alloc> g(std::in_place_type<GLike>, "wide", 1);
+  xyz::protocol<xyz::G_Subset, Alloc> copy(g);
+  EXPECT_EQ(copy.name(), "wide");
+  EXPECT_TRUE(copy.holds<GLike>());
+
+  xyz::protocol_view<const xyz::G_Subset> view(g);
+  EXPECT_EQ(view.name(), "wide");
+  EXPECT_TRUE(view.holds<GLike>());
+
+  xyz::protocol_view<xyz::G_Subset> mutable_view(g);
+  EXPECT_EQ(mutable_view.name(), "wide");
+
+  xyz::protocol<xyz::G_Subset, Alloc> moved(std::move(g));
+  EXPECT_TRUE(g.valueless_after_move());
+  EXPECT_EQ(moved.name(), "wide");
+  EXPECT_EQ(moved.target<GLike>()->count(), 1);
+}
+
+TEST(RelativeVtableTest, UniqueAndCompactProtocols) {
+  using Alloc = std::allocator<std::byte>;
+  xyz::unique_protocol<xyz::G, Alloc> unique(std::in_place_type<MoveOnlyGLike>);
+  EXPECT_EQ(unique.count(), 7);
+  EXPECT_EQ(unique.scale(2), 16);
+  xyz::unique_protocol<xyz::G_Subset, Alloc> narrowed(std::move(unique));
+  EXPECT_EQ(narrowed.name(), "MoveOnlyGLike");
+
+  xyz::unique_protocol<xyz::G> from_copyable(
+      xyz::protocol<xyz::G>(std::in_place_type<GLike>, "copyable", 3));
+  EXPECT_EQ(from_copyable.count(), 3);
+  EXPECT_TRUE(from_copyable.holds<GLike>());
+
+  xyz::compact_protocol<xyz::G> compact(std::in_place_type<GLike>, "compact", 4);
+  xyz::compact_protocol_view<xyz::G> compact_view(compact);
+  EXPECT_EQ(compact_view.count(), 4);
+  EXPECT_EQ(compact.scale(2), 10);
+  EXPECT_TRUE(compact_view.holds<GLike>());
+}
+
+struct TrivialHLike {
+  int value = 1;
+
+  std::string_view name() const noexcept { return "TrivialHLike"; }
+
+  int count() { return value++; }
+};
+
+struct OtherTrivialHLike {
+  float weight = 2.0f;
+
+  std::string_view name() const noexcept { return "OtherTrivialHLike"; }
+
+  int count() { return static_cast<int>(weight); }
+};
+
+// Stateless allocators are rebound to `std::byte` for the lifetime entries.
+// Stateful allocators are used unchanged.
+static_assert(
+    std::same_as<xyz::protocol_thunk_allocator_t<std::allocator<xyz::H>>,
+                 std::allocator<std::byte>>);
+static_assert(std::same_as<
+              xyz::protocol_thunk_allocator_t<xyz::TrackingAllocator<xyz::H>>,
+              xyz::TrackingAllocator<xyz::H>>);
+
+TEST(OptimizeSizeTest, TriviallyCopyableTypesShareLifetimeEntries) {
+  using Trivial =
+      xyz::protocol_lifetime<TrivialHLike, std::allocator<std::byte>>;
+  using OtherTrivial =
+      xyz::protocol_lifetime<OtherTrivialHLike, std::allocator<std::byte>>;
+  using NonTrivial = xyz::protocol_lifetime<ALike, std::allocator<std::byte>>;
+  EXPECT_EQ(&Trivial::clone, &OtherTrivial::clone);
+  EXPECT_EQ(&Trivial::destroy, &OtherTrivial::destroy);
+  EXPECT_NE(&Trivial::clone, &NonTrivial::clone);
+}
+
+TEST(OptimizeSizeTest, CopiesMovesAndConversions) {
+  xyz::protocol<xyz::H> trivial(std::in_place_type<TrivialHLike>);
+  EXPECT_EQ(trivial.count(), 1);
+  auto copy = trivial;
+  EXPECT_EQ(copy.count(), 2);
+  EXPECT_EQ(trivial.count(), 2);
+  EXPECT_TRUE(copy.holds<TrivialHLike>());
+  EXPECT_FALSE(copy.holds<OtherTrivialHLike>());
+
+  auto released = copy.release<TrivialHLike>();
+  EXPECT_EQ(released->count(), 3);
+
+  xyz::protocol<xyz::H> named(std::in_place_type<ALike>, 3, "named");
+  auto named_copy = named;
+  EXPECT_EQ(named_copy.name(), "named");
+  auto moved = std::move(named_copy);
+  EXPECT_TRUE(named_copy.valueless_after_move());
+  EXPECT_EQ(moved.count(), 3);
+
+  // A different default allocator, but the same lifetime entries.
+  xyz::protocol<xyz::H_Subset> subset(std::in_place_type<TrivialHLike>);
+  auto subset_copy = subset;
+  EXPECT_EQ(subset_copy.name(), "TrivialHLike");
+
+  using Alloc = std::allocator<std::byte>;
+  xyz::protocol<xyz::H, Alloc> wide(std::in_place_type<ALike>, 4, "wide");
+  xyz::protocol<xyz::H_Subset, Alloc> narrowed(wide);
+  EXPECT_EQ(narrowed.name(), "wide");
+  xyz::unique_protocol<xyz::H_Subset, Alloc> unique(std::move(wide));
+  EXPECT_TRUE(wide.valueless_after_move());
+  EXPECT_EQ(unique.name(), "wide");
+
+  xyz::compact_protocol<xyz::H> compact(std::in_place_type<TrivialHLike>);
+  auto compact_copy = compact;
+  EXPECT_EQ(compact_copy.count(), 1);
+}
+
+TEST(OptimizeSizeTest, StatefulAllocatorsAreUsedUnchanged) {
+  unsigned alloc_counter = 0;
+  unsigned dealloc_counter = 0;
+  {
+    xyz::protocol<xyz::H, xyz::TrackingAllocator<std::byte>> p(
+        std::allocator_arg,
+        xyz::TrackingAllocator<std::byte>(&alloc_counter, &dealloc_counter),
+        std::in_place_type<TrivialHLike>);
+    auto copy = p;
+    EXPECT_EQ(copy.count(), 1);
+  }
+  EXPECT_EQ(alloc_counter, 2);
+  EXPECT_EQ(dealloc_counter, 2);
+
+  unsigned out_of_line_alloc = 0;
+  unsigned out_of_line_dealloc = 0;
+  {
+    xyz::protocol<xyz::H, OutOfLineAlloc> p(
+        std::allocator_arg,
+        OutOfLineAlloc(&out_of_line_alloc, &out_of_line_dealloc),
+        std::in_place_type<ALike>, 5, "out of line");
+    auto copy = p;
+    EXPECT_EQ(copy.name(), "out of line");
+  }
+  EXPECT_EQ(out_of_line_alloc, 2);
+  EXPECT_EQ(out_of_line_dealloc, 2);
+}
+
+}  // namespace
+
+template <>
+inline constexpr bool
+    xyz::enable_deferred_destruction<DeferredAllocator<xyz::H>> = true;
+
+namespace {
+
+TEST(OptimizeSizeTest, DeferredDestructionConvertsTheAllocator) {
+  std::thread::id destroyed_on;
+  xyz::deferred_destroyer destroyer;
+  {
+    xyz::protocol<xyz::H, DeferredAllocator<xyz::H>> p(
+        std::in_place_type<ThreadRecordingALike>, &destroyed_on);
+  }
+  destroyer.flush();
+  EXPECT_NE(destroyed_on, std::thread::id());
+  EXPECT_NE(destroyed_on, std::this_thread::get_id());
+}
+
+}  // namespace
+
+namespace {
+
+struct ILike {
+  std::vector<int> values;
+  const int* received = nullptr;
+
+  std::string_view name() const noexcept { return "ILike"; }
+
+  std::size_t consume(std::vector<int> v) {
+    received = v.data();
+    values = std::move(v);
+    return values.size();
+  }
+
+  void push(int x) & { values.push_back(x); }
+
+  std::vector<int> take() && { return std::move(values); }
+};
+
+TEST(DebugDispatchTest, ArgumentsAreForwardedWithoutCopies) {
+  xyz::protocol<xyz::I> p(std::in_place_type<ILike>);
+  std::vector<int> values{1, 2, 3};
+  const int* data = values.data();
+  EXPECT_EQ(p.consume(std::move(values)), 3u);
+  EXPECT_EQ(p.target<ILike>()->received, data);
+}
+
+TEST(DebugDispatchTest, RefQualifiedMethods) {
+  xyz::protocol<xyz::I> p(std::in_place_type<ILike>);
+  p.push(1);
+  p.push(2);
+  EXPECT_EQ(p.name(), "ILike");
+  EXPECT_EQ(std::move(p).take(), (std::vector<int>{1, 2}));
+}
+
+TEST(DebugDispatchTest, ViewsUniqueAndCompactProtocols) {
+  ILike object;
+  xyz::protocol_view<xyz::I> view(object);
+  view.push(4);
+  EXPECT_EQ(object.values, std::vector<int>{4});
+  xyz::protocol_view<const xyz::I> const_view = view;
+  EXPECT_EQ(const_view.name(), "ILike");
+
+  xyz::unique_protocol<xyz::I> unique(std::in_place_type<ILike>);
+  unique.push(5);
+  EXPECT_EQ(std::move(unique).take(), std::vector<int>{5});
+
+  xyz::compact_protocol<xyz::I> compact(std::in_place_type<ILike>);
+  compact.push(6);
+  xyz::compact_protocol_view<xyz::I> compact_view(compact);
+  compact_view.push(7);
+  EXPECT_EQ(compact_view.target<ILike>()->values, (std::vector<int>{6, 7}));
+}
+
 }  // namespace
@@ -51,6 +51,8 @@ concept protocol_concept_ReferenceInterface =
     };
 
 struct const_view_vtable_ReferenceInterface {
+  type_token xyz_protocol_type;
+
   int (*get_value_51992268)(const void* ptr);
 
   void (*overloaded_c1840915)(const void* ptr, int);
@@ -63,6 +65,7 @@ struct const_view_vtable_ReferenceInterface {
 template <typename T>
 inline constexpr const_view_vtable_ReferenceInterface
     const_view_vtable_ReferenceInterface_for = {
+        type_token_for<T>,
 
         [](const void* ptr) -> int {
           return static_cast<const T*>(ptr)->get_value();
@@ -143,6 +146,8 @@ struct protocol_owning_vtable_traits<::xyz::ReferenceInterface, Allocator> {
 template <typename From>
 inline void map_vtable_members(const From* from,
                                const_view_vtable_ReferenceInterface* to) {
+  to->xyz_protocol_type = from->xyz_protocol_type;
+
   to->get_value_51992268 = from->get_value_51992268;
 
   to->overloaded_c1840915 = from->overloaded_c1840915;
@@ -155,6 +160,8 @@ inline void map_vtable_members(const From* from,
 template <typename From>
 inline void map_mutable_vtable_members(const From* from,
                                        view_vtable_ReferenceInterface* to) {
+  to->const_view.xyz_protocol_type = from->const_view.xyz_protocol_type;
+
   to->const_view.get_value_51992268 = from->const_view.get_value_51992268;
 
   to->const_view.overloaded_c1840915 = from->const_view.overloaded_c1840915;
@@ -181,30 +188,10 @@ inline void map_owning_vtable_members(
     const From* from,
     typename protocol_owning_vtable_traits<
         ::xyz::ReferenceInterface, typename From::allocator_type>::vtable* to) {
+  map_mutable_vtable_members(&from->view, &to->view);
   to->xyz_protocol_clone = from->xyz_protocol_clone;
   to->xyz_protocol_move = from->xyz_protocol_move;
   to->xyz_protocol_destroy = from->xyz_protocol_destroy;
-  to->view_vt = get_mutable_vtable<typename From::protocol_type,
-                                   ::xyz::ReferenceInterface>(from->view_vt);
-
-  to->get_value_51992268 = from->get_value_51992268;
-
-  to->update_beb1c984 = from->update_beb1c984;
-
-  to->compute_8e9404f6 = from->compute_8e9404f6;
-
-  to->overloaded_20eb843b = from->overloaded_20eb843b;
-
-  to->overloaded_c1840915 = from->overloaded_c1840915;
-
-  to->overloaded_910a8c34 = from->overloaded_910a8c34;
-
-  to->__operator__plus_equal___c2d56e3d =
-      from->__operator__plus_equal___c2d56e3d;
-
-  to->__operator__call___464ad6f1 = from->__operator__call___464ad6f1;
-
-  to->__operator__subscript___1a581dd4 = from->__operator__subscript___1a581dd4;
 }
 
 template <typename Allocator>
@@ -219,171 +206,69 @@ class protocol<::xyz::ReferenceInterface, Allocator> {
   struct vtable {
     using protocol_type = ::xyz::ReferenceInterface;
     using allocator_type = Allocator;
+    view_vtable_ReferenceInterface view;
     void* (*xyz_protocol_clone)(void* cb, const Allocator& alloc);
     void* (*xyz_protocol_move)(void* cb, const Allocator& alloc);
     void (*xyz_protocol_destroy)(void* cb, const Allocator& alloc);
-    const view_vtable_ReferenceInterface* view_vt;
-
-    int (*get_value_51992268)(void* cb);
-
-    void (*update_beb1c984)(void* cb, const ReferencePoint&, int*);
-
-    double (*compute_8e9404f6)(void* cb, double) noexcept;
-
-    void (*overloaded_20eb843b)(void* cb, int);
-
-    void (*overloaded_c1840915)(void* cb, int);
-
-    void (*overloaded_910a8c34)(void* cb, std::string_view);
-
-    void (*__operator__plus_equal___c2d56e3d)(void* cb, int);
-
-    int (*__operator__call___464ad6f1)(void* cb, int, int);
-
-    int (*__operator__subscript___1a581dd4)(void* cb, std::size_t);
   };
 
   template <typename T>
   struct vtable_impl {
-    using t_allocator =
-        typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
-    using t_alloc_traits = std::allocator_traits<t_allocator>;
-
     static void* xyz_protocol_clone(void* cb, const Allocator& alloc) {
       auto* self = static_cast<T*>(cb);
-      t_allocator t_alloc(alloc);
-      auto mem = t_alloc_traits::allocate(t_alloc, 1);
-      try {
-        t_alloc_traits::construct(t_alloc, mem, *self);
-        return mem;
-      } catch (...) {
-        t_alloc_traits::deallocate(t_alloc, mem, 1);
-        throw;
-      }
+      return protocol_storage<Allocator>::template create<T>(alloc, *self);
     }
 
     static void* xyz_protocol_move(void* cb, const Allocator& alloc) {
       auto* self = static_cast<T*>(cb);
-      t_allocator t_alloc(alloc);
-      auto mem = t_alloc_traits::allocate(t_alloc, 1);
-      try {
-        t_alloc_traits::construct(t_alloc, mem, std::move(*self));
-        return mem;
-      } catch (...) {
-        t_alloc_traits::deallocate(t_alloc, mem, 1);
-        throw;
-      }
+      return protocol_storage<Allocator>::template create<T>(alloc,
+                                                             std::move(*self));
     }
 
     static void xyz_protocol_destroy(void* cb, const Allocator& alloc) {
-      auto* self = static_cast<T*>(cb);
-      t_allocator t_alloc(alloc);
-      t_alloc_traits::destroy(t_alloc, self);
-      t_alloc_traits::deallocate(t_alloc, self, 1);
-    }
-
-    static int get_value_51992268(void* cb) {
-      auto* self = static_cast<T*>(cb);
-      return self->get_value();
-    }
-
-    static void update_beb1c984(void* cb, const ReferencePoint& a0, int* a1) {
-      auto* self = static_cast<T*>(cb);
-      self->update(std::forward<decltype(a0)>(a0),
-                   std::forward<decltype(a1)>(a1));
+      protocol_storage<Allocator>::destroy(static_cast<T*>(cb), alloc);
     }
 
-    static double compute_8e9404f6(void* cb, double a0) noexcept {
-      auto* self = static_cast<T*>(cb);
-      return self->compute(std::forward<decltype(a0)>(a0));
-    }
-
-    static void overloaded_20eb843b(void* cb, int a0) {
-      auto* self = static_cast<T*>(cb);
-      self->overloaded(std::forward<decltype(a0)>(a0));
-    }
-
-    static void overloaded_c1840915(void* cb, int a0) {
-      auto* self = static_cast<T*>(cb);
-      self->overloaded(std::forward<decltype(a0)>(a0));
-    }
-
-    static void overloaded_910a8c34(void* cb, std::string_view a0) {
-      auto* self = static_cast<T*>(cb);
-      self->overloaded(std::forward<decltype(a0)>(a0));
-    }
-
-    static void __operator__plus_equal___c2d56e3d(void* cb, int a0) {
-      auto* self = static_cast<T*>(cb);
-      self->operator+=(std::forward<decltype(a0)>(a0));
-    }
-
-    static int __operator__call___464ad6f1(void* cb, int a0, int a1) {
-      auto* self = static_cast<T*>(cb);
-      return self->operator()(std::forward<decltype(a0)>(a0),
-                              std::forward<decltype(a1)>(a1));
-    }
-
-    static int __operator__subscript___1a581dd4(void* cb, std::size_t a0) {
-      auto* self = static_cast<T*>(cb);
-      return self->operator[](std::forward<decltype(a0)>(a0));
-    }
-
-    static constexpr vtable vtable_ = {xyz_protocol_clone,
-                                       xyz_protocol_move,
-                                       xyz_protocol_destroy,
-                                       &view_vtable_ReferenceInterface_for<T>,
-
-                                       get_value_51992268,
-
-                                       update_beb1c984,
-
-                                       compute_8e9404f6,
-
-                                       overloaded_20eb843b,
-
-                                       overloaded_c1840915,
-
-                                       overloaded_910a8c34,
-
-                                       __operator__plus_equal___c2d56e3d,
-
-                                       __operator__call___464ad6f1,
-
-                                       __operator__subscript___1a581dd4
-
-    };
+    static constexpr vtable vtable_ = {view_vtable_ReferenceInterface_for<T>,
+                                       xyz_protocol_clone, xyz_protocol_move,
+                                       xyz_protocol_destroy};
   };
 
   using allocator_traits = std::allocator_traits<Allocator>;
 
   template <class U, class... Ts>
-  [[nodiscard]] constexpr void* create_storage(Ts&&... ts) const {
-    using t_allocator =
-        typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
-    t_allocator t_alloc(alloc_);
-    using t_alloc_traits = std::allocator_traits<t_allocator>;
-    auto mem = t_alloc_traits::allocate(t_alloc, 1);
-    try {
-      t_alloc_traits::construct(t_alloc, mem, std::forward<Ts>(ts)...);
-      return mem;
-    } catch (...) {
-      t_alloc_traits::deallocate(t_alloc, mem, 1);
-      throw;
+  [[nodiscard]] static constexpr void* create_storage(const Allocator& alloc,
+                                                      Ts&&... ts) {
+    return protocol_storage<Allocator>::template create<U>(
+        alloc, std::forward<Ts>(ts)...);
+  }
+
+  // With an out-of-line allocator this requires a value.
+  const Allocator& allocator() const noexcept {
+    if constexpr (protocol_storage<Allocator>::out_of_line) {
+      return protocol_storage<Allocator>::allocator(p_);
+    } else {
+      return alloc_;
     }
   }
 
   void* p_;
   const vtable* vtable_;
-  [[no_unique_address]] Allocator alloc_;
+  [[no_unique_address]] protocol_allocator_member_t<Allocator> alloc_;
 
  public:
+  using allocator_type = Allocator;
+
   template <typename Other>
     requires(!std::same_as<Other, ::xyz::ReferenceInterface>)
   constexpr protocol(protocol<Other, Allocator>&& other) noexcept(
       allocator_traits::is_always_equal::value)
       : alloc_(other.alloc_) {
-    if (alloc_ == other.alloc_) {
+    if constexpr (protocol_storage<Allocator>::out_of_line) {
+      p_ = std::exchange(other.p_, nullptr);
+      vtable_ = get_owning_vtable<Other, ::xyz::ReferenceInterface, Allocator>(
+          std::exchange(other.vtable_, nullptr));
+    } else if (alloc_ == other.alloc_) {
       p_ = std::exchange(other.p_, nullptr);
       vtable_ = get_owning_vtable<Other, ::xyz::ReferenceInterface, Allocator>(
           std::exchange(other.vtable_, nullptr));
@@ -406,15 +291,23 @@ class protocol<::xyz::ReferenceInterface, Allocator> {
   template <typename Other>
     requires(!std::same_as<Other, ::xyz::ReferenceInterface>)
   constexpr protocol(const protocol<Other, Allocator>& other)
-      : alloc_(allocator_traits::select_on_container_copy_construction(
-            other.alloc_)) {
+    requires(!protocol_storage<Allocator>::out_of_line)
+      : protocol(std::allocator_arg_t{},
+                 allocator_traits::select_on_container_copy_construction(
+                     other.alloc_),
+                 other) {}
+
+  template <typename Other>
+    requires(!std::same_as<Other, ::xyz::ReferenceInterface>)
+  constexpr protocol(const protocol<Other, Allocator>& other)
+    requires(protocol_storage<Allocator>::out_of_line)
+      : p_(nullptr), vtable_(nullptr) {
     if (!other.valueless_after_move()) {
-      p_ = other.vtable_->xyz_protocol_clone(other.p_, alloc_);
+      p_ = other.vtable_->xyz_protocol_clone(
+          other.p_, allocator_traits::select_on_container_copy_construction(
+                        other.allocator()));
       vtable_ = get_owning_vtable<Other, ::xyz::ReferenceInterface, Allocator>(
           other.vtable_);
-    } else {
-      p_ = nullptr;
-      vtable_ = nullptr;
     }
   }
 
@@ -424,7 +317,7 @@ class protocol<::xyz::ReferenceInterface, Allocator> {
                      const protocol<Other, Allocator>& other)
       : alloc_(alloc) {
     if (!other.valueless_after_move()) {
-      p_ = other.vtable_->xyz_protocol_clone(other.p_, alloc_);
+      p_ = other.vtable_->xyz_protocol_clone(other.p_, alloc);
       vtable_ = get_owning_vtable<Other, ::xyz::ReferenceInterface, Allocator>(
           other.vtable_);
     } else {
@@ -440,23 +333,17 @@ class protocol<::xyz::ReferenceInterface, Allocator> {
       protocol<Other, Allocator>&&
           other) noexcept(allocator_traits::is_always_equal::value)
       : alloc_(alloc) {
-    if (alloc_ == other.alloc_) {
+    if (other.valueless_after_move() || alloc == other.allocator()) {
       p_ = std::exchange(other.p_, nullptr);
       vtable_ = get_owning_vtable<Other, ::xyz::ReferenceInterface, Allocator>(
           std::exchange(other.vtable_, nullptr));
     } else {
-      if (!other.valueless_after_move()) {
-        p_ = other.vtable_->xyz_protocol_move(other.p_, alloc_);
-        vtable_ =
-            get_owning_vtable<Other, ::xyz::ReferenceInterface, Allocator>(
-                other.vtable_);
-        other.vtable_->xyz_protocol_destroy(other.p_, other.alloc_);
-        other.p_ = nullptr;
-        other.vtable_ = nullptr;
-      } else {
-        p_ = nullptr;
-        vtable_ = nullptr;
-      }
+      p_ = other.vtable_->xyz_protocol_move(other.p_, alloc);
+      vtable_ = get_owning_vtable<Other, ::xyz::ReferenceInterface, Allocator>(
+          other.vtable_);
+      other.vtable_->xyz_protocol_destroy(other.p_, other.allocator());
+      other.p_ = nullptr;
+      other.vtable_ = nullptr;
     }
   }
 
@@ -497,20 +384,39 @@ class protocol<::xyz::ReferenceInterface, Allocator> {
                  ilist, std::forward<Ts>(ts)...) {}
 
   constexpr protocol(const protocol& other)
+    requires(!protocol_storage<Allocator>::out_of_line)
       : protocol(std::allocator_arg_t{},
                  allocator_traits::select_on_container_copy_construction(
                      other.alloc_),
                  other) {}
 
+  constexpr protocol(const protocol& other)
+    requires(protocol_storage<Allocator>::out_of_line)
+      : p_(nullptr), vtable_(nullptr) {
+    if (!other.valueless_after_move()) {
+      p_ = other.vtable_->xyz_protocol_clone(
+          other.p_, allocator_traits::select_on_container_copy_construction(
+                        other.allocator()));
+      vtable_ = other.vtable_;
+    }
+  }
+
   constexpr protocol(protocol&& other) noexcept(
       allocator_traits::is_always_equal::value)
+    requires(!protocol_storage<Allocator>::out_of_line)
       : protocol(std::allocator_arg_t{}, other.alloc_, std::move(other)) {}
 
+  // The allocator moves with the object, so no reallocation is needed.
+  constexpr protocol(protocol&& other) noexcept
+    requires(protocol_storage<Allocator>::out_of_line)
+      : p_(std::exchange(other.p_, nullptr)),
+        vtable_(std::exchange(other.vtable_, nullptr)) {}
+
   explicit constexpr protocol(std::allocator_arg_t, const Allocator& alloc)
     requires std::default_initializable<::xyz::ReferenceInterface> &&
              std::copy_constructible<::xyz::ReferenceInterface>
       : alloc_(alloc) {
-    p_ = create_storage<::xyz::ReferenceInterface>();
+    p_ = create_storage<::xyz::ReferenceInterface>(alloc);
     vtable_ = &vtable_impl<::xyz::ReferenceInterface>::vtable_;
   }
 
@@ -522,7 +428,7 @@ class protocol<::xyz::ReferenceInterface, Allocator> {
             std::copy_constructible<std::remove_cvref_t<U>> &&
             protocol_concept_ReferenceInterface<U>
       : alloc_(alloc) {
-    p_ = create_storage<std::remove_cvref_t<U>>(std::forward<U>(u));
+    p_ = create_storage<std::remove_cvref_t<U>>(alloc, std::forward<U>(u));
     vtable_ = &vtable_impl<std::remove_cvref_t<U>>::vtable_;
   }
 
@@ -534,7 +440,7 @@ class protocol<::xyz::ReferenceInterface, Allocator> {
              std::copy_constructible<U> &&
              protocol_concept_ReferenceInterface<U>
       : alloc_(alloc) {
-    p_ = create_storage<U>(std::forward<Ts>(ts)...);
+    p_ = create_storage<U>(alloc, std::forward<Ts>(ts)...);
     vtable_ = &vtable_impl<U>::vtable_;
   }
 
@@ -548,15 +454,27 @@ class protocol<::xyz::ReferenceInterface, Allocator> {
              std::copy_constructible<U> &&
              protocol_concept_ReferenceInterface<U>
       : alloc_(alloc) {
-    p_ = create_storage<U>(ilist, std::forward<Ts>(ts)...);
+    p_ = create_storage<U>(alloc, ilist, std::forward<Ts>(ts)...);
     vtable_ = &vtable_impl<U>::vtable_;
   }
 
+  // Takes ownership of `*ptr`, which must have been allocated and constructed
+  // through an allocator equal to `alloc` rebound to `U`.
+  template <class U>
+  constexpr protocol(adopt_t, const Allocator& alloc, U* ptr) noexcept
+    requires std::same_as<std::remove_cv_t<U>, U> &&
+             not_protocol_or_view<U> && std::copy_constructible<U> &&
+             protocol_concept_ReferenceInterface<U> &&
+             (!protocol_storage<Allocator>::out_of_line)
+      : p_(ptr), vtable_(&vtable_impl<U>::vtable_), alloc_(alloc) {
+    assert(ptr != nullptr);
+  }
+
   constexpr protocol(std::allocator_arg_t, const Allocator& alloc,
                      const protocol& other)
       : alloc_(alloc) {
     if (!other.valueless_after_move()) {
-      p_ = other.vtable_->xyz_protocol_clone(other.p_, alloc_);
+      p_ = other.vtable_->xyz_protocol_clone(other.p_, alloc);
       vtable_ = other.vtable_;
     } else {
       p_ = nullptr;
@@ -572,26 +490,89 @@ class protocol<::xyz::ReferenceInterface, Allocator> {
       p_ = std::exchange(other.p_, nullptr);
       vtable_ = std::exchange(other.vtable_, nullptr);
     } else {
-      if (alloc_ == other.alloc_) {
+      if (other.valueless_after_move() || alloc == other.allocator()) {
         p_ = std::exchange(other.p_, nullptr);
         vtable_ = std::exchange(other.vtable_, nullptr);
       } else {
-        if (!other.valueless_after_move()) {
-          p_ = other.vtable_->xyz_protocol_move(other.p_, alloc_);
-          vtable_ = other.vtable_;
-        } else {
-          p_ = nullptr;
-          vtable_ = nullptr;
-        }
+        p_ = other.vtable_->xyz_protocol_move(other.p_, alloc);
+        vtable_ = other.vtable_;
       }
     }
   }
 
   constexpr bool valueless_after_move() const noexcept { return p_ == nullptr; }
 
+  allocator_type get_allocator() const noexcept { return allocator(); }
+
+  template <class U>
+    requires std::same_as<std::remove_cvref_t<U>, U> &&
+             not_protocol_or_view<U> && std::copy_constructible<U> &&
+             protocol_concept_ReferenceInterface<U>
+  bool holds() const noexcept {
+    return vtable_ != nullptr &&
+           (vtable_ == &vtable_impl<U>::vtable_ ||
+            vtable_->view.const_view.xyz_protocol_type == type_token_for<U>);
+  }
+
+  template <class U>
+    requires std::same_as<std::remove_cvref_t<U>, U> &&
+             not_protocol_or_view<U> && std::copy_constructible<U> &&
+             protocol_concept_ReferenceInterface<U>
+  U* target() noexcept { return holds<U>() ? static_cast<U*>(p_) : nullptr; }
+
+  template <class U>
+    requires std::same_as<std::remove_cvref_t<U>, U> &&
+             not_protocol_or_view<U> && std::copy_constructible<U> &&
+             protocol_concept_ReferenceInterface<U>
+  const U* target() const noexcept {
+    return holds<U>() ? static_cast<const U*>(p_) : nullptr;
+  }
+
+  template <class U>
+    requires std::same_as<std::remove_cvref_t<U>, U> &&
+             not_protocol_or_view<U> && std::copy_constructible<U> &&
+             protocol_concept_ReferenceInterface<U>
+  U& target_unchecked() noexcept {
+    assert(holds<U>());
+    return *static_cast<U*>(p_);
+  }
+
+  template <class U>
+    requires std::same_as<std::remove_cvref_t<U>, U> &&
+             not_protocol_or_view<U> && std::copy_constructible<U> &&
+             protocol_concept_ReferenceInterface<U>
+  const U& target_unchecked() const noexcept {
+    assert(holds<U>());
+    return *static_cast<const U*>(p_);
+  }
+
+  // Gives up ownership of the held `U` without moving it. Returns null and
+  // leaves the protocol unchanged if it does not hold a `U`; otherwise the
+  // protocol is left valueless.
+  template <class U>
+    requires std::same_as<std::remove_cvref_t<U>, U> &&
+             not_protocol_or_view<U> && std::copy_constructible<U> &&
+             protocol_concept_ReferenceInterface<U> &&
+             (!protocol_storage<Allocator>::out_of_line)
+  std::unique_ptr<U, allocator_delete<U, Allocator>> release() noexcept {
+    if (!holds<U>()) {
+      return std::unique_ptr<U, allocator_delete<U, Allocator>>(
+          nullptr, allocator_delete<U, Allocator>(alloc_));
+    }
+    vtable_ = nullptr;
+    return std::unique_ptr<U, allocator_delete<U, Allocator>>(
+        static_cast<U*>(std::exchange(p_, nullptr)),
+        allocator_delete<U, Allocator>(alloc_));
+  }
+
   ~protocol() {
     if (p_ != nullptr) {
-      vtable_->xyz_protocol_destroy(p_, alloc_);
+      if constexpr (enable_deferred_destruction<Allocator>) {
+        deferred_destroyer::destroy(p_, vtable_->xyz_protocol_destroy,
+                                    allocator());
+      } else {
+        vtable_->xyz_protocol_destroy(p_, allocator());
+      }
     }
   }
 
@@ -620,43 +601,123 @@ class protocol<::xyz::ReferenceInterface, Allocator> {
   }
 
  public:
-  int get_value() const { return vtable_->get_value_51992268(p_); }
+  int get_value() const {
+    return vtable_->view.const_view.get_value_51992268(p_);
+  }
 
   void update(const ReferencePoint& a0, int* a1) {
-    return vtable_->update_beb1c984(p_, std::forward<decltype(a0)>(a0),
-                                    std::forward<decltype(a1)>(a1));
+    return vtable_->view.update_beb1c984(p_, std::forward<decltype(a0)>(a0),
+                                         std::forward<decltype(a1)>(a1));
   }
 
   double compute(double a0) noexcept {
-    return vtable_->compute_8e9404f6(p_, std::forward<decltype(a0)>(a0));
+    return vtable_->view.compute_8e9404f6(p_, std::forward<decltype(a0)>(a0));
   }
 
   void overloaded(int a0) {
-    return vtable_->overloaded_20eb843b(p_, std::forward<decltype(a0)>(a0));
+    return vtable_->view.overloaded_20eb843b(p_,
+                                             std::forward<decltype(a0)>(a0));
   }
 
   void overloaded(int a0) const {
-    return vtable_->overloaded_c1840915(p_, std::forward<decltype(a0)>(a0));
+    return vtable_->view.const_view.overloaded_c1840915(
+        p_, std::forward<decltype(a0)>(a0));
   }
 
   void overloaded(std::string_view a0) const {
-    return vtable_->overloaded_910a8c34(p_, std::forward<decltype(a0)>(a0));
+    return vtable_->view.const_view.overloaded_910a8c34(
+        p_, std::forward<decltype(a0)>(a0));
   }
 
   void operator+=(int a0) {
-    return vtable_->__operator__plus_equal___c2d56e3d(
+    return vtable_->view.__operator__plus_equal___c2d56e3d(
         p_, std::forward<decltype(a0)>(a0));
   }
 
   int operator()(int a0, int a1) const {
-    return vtable_->__operator__call___464ad6f1(
+    return vtable_->view.const_view.__operator__call___464ad6f1(
         p_, std::forward<decltype(a0)>(a0), std::forward<decltype(a1)>(a1));
   }
 
   int operator[](std::size_t a0) {
-    return vtable_->__operator__subscript___1a581dd4(
+    return vtable_->view.__operator__subscript___1a581dd4(
         p_, std::forward<decltype(a0)>(a0));
   }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<int (::xyz::ReferenceInterface::*)() const>(
+                    &::xyz::ReferenceInterface::get_value)>
+  bound_method<int() const> bind() const noexcept {
+    return {p_, vtable_->view.const_view.get_value_51992268};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<void (::xyz::ReferenceInterface::*)(
+                                const ReferencePoint&, int*)>(
+                    &::xyz::ReferenceInterface::update)>
+  bound_method<void(const ReferencePoint&, int*)> bind() noexcept {
+    return {p_, vtable_->view.update_beb1c984};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<double (::xyz::ReferenceInterface::*)(
+                                double) noexcept>(
+                    &::xyz::ReferenceInterface::compute)>
+  bound_method<double(double) noexcept> bind() noexcept {
+    return {p_, vtable_->view.compute_8e9404f6};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<void (::xyz::ReferenceInterface::*)(int)>(
+                    &::xyz::ReferenceInterface::overloaded)>
+  bound_method<void(int)> bind() noexcept {
+    return {p_, vtable_->view.overloaded_20eb843b};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<void (::xyz::ReferenceInterface::*)(int) const>(
+                    &::xyz::ReferenceInterface::overloaded)>
+  bound_method<void(int) const> bind() const noexcept {
+    return {p_, vtable_->view.const_view.overloaded_c1840915};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<void (::xyz::ReferenceInterface::*)(
+                                std::string_view) const>(
+                    &::xyz::ReferenceInterface::overloaded)>
+  bound_method<void(std::string_view) const> bind() const noexcept {
+    return {p_, vtable_->view.const_view.overloaded_910a8c34};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<void (::xyz::ReferenceInterface::*)(int)>(
+                    &::xyz::ReferenceInterface::operator+=)>
+  bound_method<void(int)> bind() noexcept {
+    return {p_, vtable_->view.__operator__plus_equal___c2d56e3d};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<int (::xyz::ReferenceInterface::*)(int, int) const>(
+                    &::xyz::ReferenceInterface::operator())>
+  bound_method<int(int, int) const> bind() const noexcept {
+    return {p_, vtable_->view.const_view.__operator__call___464ad6f1};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<int (::xyz::ReferenceInterface::*)(std::size_t)>(
+                    &::xyz::ReferenceInterface::operator[])>
+  bound_method<int(std::size_t)> bind() noexcept {
+    return {p_, vtable_->view.__operator__subscript___1a581dd4};
+  }
 };
 
 template <>
@@ -696,14 +757,14 @@ class protocol_view<const ::xyz::ReferenceInterface> {
 
   template <typename Alloc>
   protocol_view(const protocol<::xyz::ReferenceInterface, Alloc>& p) noexcept
-      : ptr_(checked_ptr(p)), vptr_(&p.vtable_->view_vt->const_view) {}
+      : ptr_(checked_ptr(p)), vptr_(&p.vtable_->view.const_view) {}
 
   template <typename Alloc>
   protocol_view(const protocol<::xyz::ReferenceInterface, Alloc>&&) = delete;
 
   template <typename Alloc>
   protocol_view(protocol<::xyz::ReferenceInterface, Alloc>& p) noexcept
-      : ptr_(checked_ptr(p)), vptr_(&p.vtable_->view_vt->const_view) {}
+      : ptr_(checked_ptr(p)), vptr_(&p.vtable_->view.const_view) {}
 
   template <typename Alloc>
   protocol_view(protocol<::xyz::ReferenceInterface, Alloc>&&) = delete;
@@ -742,6 +803,32 @@ class protocol_view<const ::xyz::ReferenceInterface> {
     requires(!std::same_as<Other, ::xyz::ReferenceInterface>)
   protocol_view(protocol<Other, Alloc>&&) = delete;
 
+  template <typename U>
+    requires std::same_as<std::remove_cvref_t<U>, U> &&
+             protocol_const_concept_ReferenceInterface<U> &&
+             not_protocol_or_view<U>
+  bool holds() const noexcept {
+    return vptr_ == &const_view_vtable_ReferenceInterface_for<U> ||
+           vptr_->xyz_protocol_type == type_token_for<U>;
+  }
+
+  template <typename U>
+    requires std::same_as<std::remove_cvref_t<U>, U> &&
+             protocol_const_concept_ReferenceInterface<U> &&
+             not_protocol_or_view<U>
+  const U* target() const noexcept {
+    return holds<U>() ? static_cast<const U*>(ptr_) : nullptr;
+  }
+
+  template <typename U>
+    requires std::same_as<std::remove_cvref_t<U>, U> &&
+             protocol_const_concept_ReferenceInterface<U> &&
+             not_protocol_or_view<U>
+  const U& target_unchecked() const noexcept {
+    assert(holds<U>());
+    return *static_cast<const U*>(ptr_);
+  }
+
   int get_value() const { return vptr_->get_value_51992268(ptr_); }
 
   void overloaded(int a0) const {
@@ -756,6 +843,39 @@ class protocol_view<const ::xyz::ReferenceInterface> {
     return vptr_->__operator__call___464ad6f1(
         ptr_, std::forward<decltype(a0)>(a0), std::forward<decltype(a1)>(a1));
   }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<int (::xyz::ReferenceInterface::*)() const>(
+                    &::xyz::ReferenceInterface::get_value)>
+  bound_method<int() const> bind() const noexcept {
+    return {ptr_, vptr_->get_value_51992268};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<void (::xyz::ReferenceInterface::*)(int) const>(
+                    &::xyz::ReferenceInterface::overloaded)>
+  bound_method<void(int) const> bind() const noexcept {
+    return {ptr_, vptr_->overloaded_c1840915};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<void (::xyz::ReferenceInterface::*)(
+                                std::string_view) const>(
+                    &::xyz::ReferenceInterface::overloaded)>
+  bound_method<void(std::string_view) const> bind() const noexcept {
+    return {ptr_, vptr_->overloaded_910a8c34};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<int (::xyz::ReferenceInterface::*)(int, int) const>(
+                    &::xyz::ReferenceInterface::operator())>
+  bound_method<int(int, int) const> bind() const noexcept {
+    return {ptr_, vptr_->__operator__call___464ad6f1};
+  }
 };
 
 template <>
@@ -786,7 +906,7 @@ class protocol_view<::xyz::ReferenceInterface> {
 
   template <typename Alloc>
   protocol_view(protocol<::xyz::ReferenceInterface, Alloc>& p) noexcept
-      : ptr_(checked_ptr(p)), vptr_(p.vtable_->view_vt) {}
+      : ptr_(checked_ptr(p)), vptr_(&p.vtable_->view) {}
 
   template <typename Alloc>
   protocol_view(protocol<::xyz::ReferenceInterface, Alloc>&&) = delete;
@@ -808,6 +928,29 @@ class protocol_view<::xyz::ReferenceInterface> {
     requires(!std::same_as<Other, ::xyz::ReferenceInterface>)
   protocol_view(protocol<Other, Alloc>&&) = delete;
 
+  template <typename U>
+    requires std::same_as<std::remove_cvref_t<U>, U> &&
+             protocol_concept_ReferenceInterface<U> && not_protocol_or_view<U>
+  bool holds() const noexcept {
+    return vptr_ == &view_vtable_ReferenceInterface_for<U> ||
+           vptr_->const_view.xyz_protocol_type == type_token_for<U>;
+  }
+
+  template <typename U>
+    requires std::same_as<std::remove_cvref_t<U>, U> &&
+             protocol_concept_ReferenceInterface<U> && not_protocol_or_view<U>
+  U* target() const noexcept {
+    return holds<U>() ? static_cast<U*>(ptr_) : nullptr;
+  }
+
+  template <typename U>
+    requires std::same_as<std::remove_cvref_t<U>, U> &&
+             protocol_concept_ReferenceInterface<U> && not_protocol_or_view<U>
+  U& target_unchecked() const noexcept {
+    assert(holds<U>());
+    return *static_cast<U*>(ptr_);
+  }
+
   int get_value() const { return vptr_->const_view.get_value_51992268(ptr_); }
 
   void update(const ReferencePoint& a0, int* a1) const {
@@ -845,6 +988,81 @@ class protocol_view<::xyz::ReferenceInterface> {
     return vptr_->__operator__subscript___1a581dd4(
         ptr_, std::forward<decltype(a0)>(a0));
   }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<int (::xyz::ReferenceInterface::*)() const>(
+                    &::xyz::ReferenceInterface::get_value)>
+  bound_method<int() const> bind() const noexcept {
+    return {ptr_, vptr_->const_view.get_value_51992268};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<void (::xyz::ReferenceInterface::*)(
+                                const ReferencePoint&, int*)>(
+                    &::xyz::ReferenceInterface::update)>
+  bound_method<void(const ReferencePoint&, int*)> bind() const noexcept {
+    return {ptr_, vptr_->update_beb1c984};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<double (::xyz::ReferenceInterface::*)(
+                                double) noexcept>(
+                    &::xyz::ReferenceInterface::compute)>
+  bound_method<double(double) noexcept> bind() const noexcept {
+    return {ptr_, vptr_->compute_8e9404f6};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<void (::xyz::ReferenceInterface::*)(int)>(
+                    &::xyz::ReferenceInterface::overloaded)>
+  bound_method<void(int)> bind() const noexcept {
+    return {ptr_, vptr_->overloaded_20eb843b};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<void (::xyz::ReferenceInterface::*)(int) const>(
+                    &::xyz::ReferenceInterface::overloaded)>
+  bound_method<void(int) const> bind() const noexcept {
+    return {ptr_, vptr_->const_view.overloaded_c1840915};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<void (::xyz::ReferenceInterface::*)(
+                                std::string_view) const>(
+                    &::xyz::ReferenceInterface::overloaded)>
+  bound_method<void(std::string_view) const> bind() const noexcept {
+    return {ptr_, vptr_->const_view.overloaded_910a8c34};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<void (::xyz::ReferenceInterface::*)(int)>(
+                    &::xyz::ReferenceInterface::operator+=)>
+  bound_method<void(int)> bind() const noexcept {
+    return {ptr_, vptr_->__operator__plus_equal___c2d56e3d};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<int (::xyz::ReferenceInterface::*)(int, int) const>(
+                    &::xyz::ReferenceInterface::operator())>
+  bound_method<int(int, int) const> bind() const noexcept {
+    return {ptr_, vptr_->const_view.__operator__call___464ad6f1};
+  }
+
+  template <auto Method>
+    requires same_member_function<
+        Method, static_cast<int (::xyz::ReferenceInterface::*)(std::size_t)>(
+                    &::xyz::ReferenceInterface::operator[])>
+  bound_method<int(std::size_t)> bind() const noexcept {
+    return {ptr_, vptr_->__operator__subscript___1a581dd4};
+  }
 };
 
 inline constexpr protocol_view<const ::xyz::ReferenceInterface>::protocol_view(
@@ -0,0 +1,340 @@
+"""Measure how generating and compiling protocols scales with their size."""
+
+import argparse
+import json
+import os
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+from typing import Any
+from typing import Dict
+from typing import List
+
+SCRIPTS_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(SCRIPTS_DIR)
+GENERATOR = os.path.join(SCRIPTS_DIR, "generate_protocol.py")
+TEMPLATE = os.path.join(SCRIPTS_DIR, "protocol.j2")
+
+METRICS = ("generator_seconds", "compile_seconds", "peak_memory_kib", "object_bytes")
+
+# Growth below these amounts is measurement noise, whatever the tolerance.
+NOISE = {
+    "generator_seconds": 0.1,
+    "compile_seconds": 0.1,
+    "peak_memory_kib": 4096,
+    "object_bytes": 4096,
+}
+
+
+def method_declaration(i: int) -> str:
+    """Declare the i-th synthetic method; even methods are const."""
+    if i % 2 == 0:
+        return f"int m{i}(int x) const;"
+    return f"void m{i}(int x);"
+
+
+def method_definition(i: int) -> str:
+    """Define the i-th synthetic method for a concrete type."""
+    if i % 2 == 0:
+        return f"int m{i}(int x) const {{ return x + value + {i}; }}"
+    return f"void m{i}(int x) {{ value += x + {i}; }}"
+
+
+def interface_source(name: str, methods: List[int]) -> str:
+    """Return a header that declares interface name with the given methods."""
+    lines = [f"struct {name} {{"]
+    lines += [f"  {method_declaration(i)}" for i in methods]
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def concrete_types_source(methods: List[int]) -> str:
+    """Return a class template whose instances implement the given methods."""
+    lines = ["template <int J>", "struct Impl {", "  int value = J;"]
+    lines += [f"  {method_definition(i)}" for i in methods]
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def grid_source(methods: int, types: int) -> str:
+    """Return a translation unit that stores types concrete types in protocols."""
+    return f"""#include <utility>
+#include <vector>
+
+#include "protocol_Synthetic.h"
+
+{concrete_types_source(list(range(methods)))}
+template <int... Js>
+std::vector<xyz::protocol<Synthetic>> make(std::integer_sequence<int, Js...>) {{
+  std::vector<xyz::protocol<Synthetic>> protocols;
+  (protocols.emplace_back(std::in_place_type<Impl<Js>>), ...);
+  return protocols;
+}}
+
+int use() {{
+  auto protocols = make(std::make_integer_sequence<int, {types}>{{}});
+  auto copies = protocols;
+  copies.front().m1(1);
+  return copies.front().m0(1);
+}}
+"""
+
+
+def chain_source(length: int) -> str:
+    """Return a translation unit that narrows a protocol length times."""
+    includes = "".join(f'#include "protocol_Chain{k}.h"\n' for k in range(length + 1))
+    steps = "".join(
+        f"  xyz::protocol<Chain{k}, Allocator> p{k}(std::move(p{k - 1}));\n"
+        for k in range(1, length + 1)
+    )
+    return f"""#include <cstddef>
+#include <memory>
+#include <utility>
+
+{includes}
+{concrete_types_source(list(range(length + 1)))}
+// Narrowing conversions need protocols with the same allocator.
+using Allocator = std::allocator<std::byte>;
+
+int use() {{
+  xyz::protocol<Chain0, Allocator> p0(std::in_place_type<Impl<0>>);
+{steps}  return p{length}.m0(1);
+}}
+"""
+
+
+def run_measured(command: List[str], timeout: float) -> Dict[str, Any]:
+    """
+    Run command and return its status, wall time and peak memory.
+
+    The peak resident set size covers the processes that command waits for,
+    such as the compiler proper behind the driver.
+    """
+    # Diagnostics go to a file: a full pipe would block the compiler.
+    with tempfile.TemporaryFile() as stderr:
+        start = time.perf_counter()
+        process = subprocess.Popen(
+            command,
+            stdout=subprocess.DEVNULL,
+            stderr=stderr,
+            start_new_session=True,
+        )
+        while True:
+            pid, status, usage = os.wait4(process.pid, os.WNOHANG)
+            if pid:
+                break
+            if time.perf_counter() - start > timeout:
+                os.killpg(process.pid, signal.SIGKILL)
+                os.wait4(process.pid, 0)
+                return {"status": "timeout"}
+            time.sleep(0.01)
+        seconds = time.perf_counter() - start
+        exit_code = os.waitstatus_to_exitcode(status)
+        if exit_code < 0:
+            # Typically the kernel ran out of memory.
+            return {"status": f"killed by signal {-exit_code}"}
+        if exit_code != 0:
+            stderr.seek(0)
+            return {"status": "failed", "error": stderr.read().decode()[:2000]}
+    return {"status": "ok", "seconds": seconds, "peak_memory_kib": usage.ru_maxrss}
+
+
+def generate(
+    interfaces: Dict[str, str], work_dir: str, compiler: str, timeout: float
+) -> Dict[str, Any]:
+    """Write interfaces and generate their protocols in one batch."""
+    batch = []
+    for name, source in interfaces.items():
+        header = os.path.join(work_dir, f"interface_{name}.h")
+        with open(header, "w") as f:
+            f.write(source)
+        batch.append(
+            {
+                "input": header,
+                "output": os.path.join(work_dir, f"protocol_{name}.h"),
+                "class_name": name,
+                "header": os.path.basename(header),
+            }
+        )
+    manifest = os.path.join(work_dir, "protocols.json")
+    with open(manifest, "w") as f:
+        json.dump(batch, f)
+    return run_measured(
+        [sys.executable, GENERATOR, "--batch", manifest, "--template", TEMPLATE]
+        + ["--compiler", compiler, "--formatter", "whitespace"],
+        timeout,
+    )
+
+
+def measure(
+    point: Dict[str, Any],
+    interfaces: Dict[str, str],
+    source: str,
+    compiler: str,
+    flags: List[str],
+    timeout: float,
+) -> Dict[str, Any]:
+    """Generate the interfaces of point, compile source and record the metrics."""
+    with tempfile.TemporaryDirectory() as work_dir:
+        generated = generate(interfaces, work_dir, compiler, timeout)
+        if generated["status"] != "ok":
+            return {**point, "status": f"generator {generated['status']}"}
+        point["generator_seconds"] = round(generated["seconds"], 3)
+
+        source_path = os.path.join(work_dir, "use.cc")
+        with open(source_path, "w") as f:
+            f.write(source)
+        object_path = os.path.join(work_dir, "use.o")
+        compiled = run_measured(
+            [compiler, *flags, f"-I{REPO_DIR}", f"-I{work_dir}"]
+            + ["-c", source_path, "-o", object_path],
+            timeout,
+        )
+        if compiled["status"] != "ok":
+            if "error" in compiled:
+                print(compiled["error"], file=sys.stderr)
+            return {**point, "status": f"compiler {compiled['status']}"}
+        point["compile_seconds"] = round(compiled["seconds"], 3)
+        point["peak_memory_kib"] = compiled["peak_memory_kib"]
+        point["object_bytes"] = os.path.getsize(object_path)
+        point["status"] = "ok"
+        return point
+
+
+def compare(
+    baseline: Dict[str, Any], results: Dict[str, Any], tolerance: float
+) -> List[str]:
+    """
+    Return the regressions of results against baseline.
+
+    A metric regresses when it grows by more than tolerance, as a fraction,
+    and by more than its NOISE. A point that no longer completes regresses.
+    """
+    before = {point["name"]: point for point in baseline["points"]}
+    regressions = []
+    for point in results["points"]:
+        old = before.get(point["name"])
+        if old is None or old["status"] != "ok":
+            continue
+        if point["status"] != "ok":
+            regressions.append(f"{point['name']}: {point['status']}")
+            continue
+        for metric in METRICS:
+            if (
+                point[metric] > old[metric] * (1 + tolerance)
+                and point[metric] - old[metric] > NOISE[metric]
+            ):
+                regressions.append(
+                    f"{point['name']}: {metric} {old[metric]} -> {point[metric]}"
+                )
+    return regressions
+
+
+def format_point(point: Dict[str, Any]) -> str:
+    """Format one measured point as a line of the summary."""
+    if point["status"] != "ok":
+        return f"{point['name']:<24}  {point['status']}"
+    return (
+        f"{point['name']:<24}  generate {point['generator_seconds']:7.2f} s"
+        f"  compile {point['compile_seconds']:7.2f} s"
+        f"  {point['peak_memory_kib'] // 1024:6} MiB"
+        f"  {point['object_bytes'] // 1024:8} KiB"
+    )
+
+
+def main() -> None:
+    """Measure every point and write the results as JSON."""
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--compiler", default="c++", help="C++ compiler")
+    parser.add_argument(
+        "--methods",
+        type=int,
+        nargs="+",
+        default=[10, 100, 1000],
+        help="Methods per interface",
+    )
+    parser.add_argument(
+        "--types",
+        type=int,
+        nargs="+",
+        default=[1, 50, 500],
+        help="Concrete types per interface",
+    )
+    parser.add_argument(
+        "--chains",
+        type=int,
+        nargs="*",
+        default=[1, 8, 32],
+        help="Lengths of narrowing chains",
+    )
+    parser.add_argument(
+        "--flag",
+        action="append",
+        help="Compiler flag; defaults to -std=c++20 -O2",
+    )
+    parser.add_argument(
+        "--timeout", type=float, default=600, help="Seconds per generator or compile"
+    )
+    parser.add_argument("--output", help="Write the results to this JSON file")
+    parser.add_argument("--baseline", help="Fail on regressions against this JSON")
+    parser.add_argument(
+        "--tolerance",
+        type=float,
+        default=0.25,
+        help="Growth of a metric, as a fraction, that counts as a regression",
+    )
+    args = parser.parse_args()
+
+    flags = args.flag or ["-std=c++20", "-O2"]
+    results: Dict[str, Any] = {
+        "compiler": args.compiler,
+        "flags": flags,
+        "points": [],
+    }
+    for methods in args.methods:
+        for types in args.types:
+            point = {
+                "name": f"methods={methods} types={types}",
+                "methods": methods,
+                "types": types,
+            }
+            interfaces = {
+                "Synthetic": interface_source("Synthetic", list(range(methods)))
+            }
+            source = grid_source(methods, types)
+            results["points"].append(
+                measure(point, interfaces, source, args.compiler, flags, args.timeout)
+            )
+            print(format_point(results["points"][-1]), flush=True)
+    for length in args.chains:
+        point = {"name": f"chain={length}", "chain": length}
+        # Each interface of the chain drops the last method of the previous one.
+        interfaces = {
+            f"Chain{k}": interface_source(f"Chain{k}", list(range(length + 1 - k)))
+            for k in range(length + 1)
+        }
+        source = chain_source(length)
+        results["points"].append(
+            measure(point, interfaces, source, args.compiler, flags, args.timeout)
+        )
+        print(format_point(results["points"][-1]), flush=True)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=2)
+            f.write("\n")
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        regressions = compare(baseline, results, args.tolerance)
+        for regression in regressions:
+            print(f"regression: {regression}", file=sys.stderr)
+        if regressions:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,138 @@
+"""Compare compile times of a translation unit with and without extern templates."""
+
+import argparse
+import math
+import os
+import subprocess
+import tempfile
+import time
+from typing import List
+from typing import Optional
+from typing import Tuple
+
+
+def compile_time(
+    compiler: str, source: str, flags: List[str], output: str, repetitions: int
+) -> Tuple[float, int]:
+    """Return the fastest of repetitions compiles of source and the object size."""
+    times = []
+    for _ in range(repetitions):
+        start = time.perf_counter()
+        subprocess.run([compiler, *flags, "-c", source, "-o", output], check=True)
+        times.append(time.perf_counter() - start)
+    return min(times), os.path.getsize(output)
+
+
+def break_even(implicit: float, extern: float, library: float) -> Optional[int]:
+    """
+    Return the number of translation units from which extern templates pay off.
+
+    Each translation unit saves implicit - extern seconds, and the library is
+    compiled once. Returns None when extern templates never pay off.
+    """
+    saving = implicit - extern
+    if saving <= 0:
+        return None
+    return max(1, math.ceil(library / saving))
+
+
+def main() -> None:
+    """Print compile times and object sizes for each optimization level."""
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("source", help="Translation unit that uses protocols")
+    parser.add_argument("--compiler", default="c++", help="C++ compiler")
+    parser.add_argument(
+        "--flag", action="append", default=[], help="Flag of every compile"
+    )
+    parser.add_argument(
+        "--implicit-flag",
+        action="append",
+        default=[],
+        help="Flag of the compile that instantiates every protocol",
+    )
+    parser.add_argument(
+        "--extern-flag",
+        action="append",
+        default=[],
+        help="Flag of the compiles that use extern templates",
+    )
+    parser.add_argument(
+        "--library-source",
+        action="append",
+        default=[],
+        help="Source of the explicit instantiations, compiled once",
+    )
+    parser.add_argument(
+        "--optimization",
+        action="append",
+        help="Optimization flag; defaults to -O0 and -O2",
+    )
+    parser.add_argument("--repetitions", type=int, default=3, help="Best of")
+    parser.add_argument(
+        "--translation-units",
+        type=int,
+        default=10,
+        help="Translation units of the projected build time",
+    )
+    args = parser.parse_args()
+
+    units = args.translation_units
+    with tempfile.TemporaryDirectory() as work_dir:
+        output = os.path.join(work_dir, "benchmark.o")
+        for optimization in args.optimization or ["-O0", "-O2"]:
+            common = [*args.flag, optimization]
+            implicit, implicit_size = compile_time(
+                args.compiler,
+                args.source,
+                [*common, *args.implicit_flag],
+                output,
+                args.repetitions,
+            )
+            extern, extern_size = compile_time(
+                args.compiler,
+                args.source,
+                [*common, *args.extern_flag],
+                output,
+                args.repetitions,
+            )
+            library = 0.0
+            library_size = 0
+            for source in args.library_source:
+                seconds, size = compile_time(
+                    args.compiler,
+                    source,
+                    [*common, *args.extern_flag],
+                    output,
+                    args.repetitions,
+                )
+                library += seconds
+                library_size += size
+
+            units_to_pay_off = break_even(implicit, extern, library)
+            pays_off = (
+                f"from {units_to_pay_off} translation units"
+                if units_to_pay_off is not None
+                else "never"
+            )
+            print(optimization)
+            print(
+                f"  implicit instantiation  {implicit:7.2f} s per TU"
+                f"  {implicit_size // 1024:6} KiB"
+            )
+            print(
+                f"  extern templates        {extern:7.2f} s per TU"
+                f"  {extern_size // 1024:6} KiB"
+            )
+            print(
+                f"  instantiation library   {library:7.2f} s once"
+                f"    {library_size // 1024:6} KiB"
+            )
+            print(
+                f"  {units} TUs: {units * implicit:.1f} s implicit, "
+                f"{units * extern + library:.1f} s extern; "
+                f"extern templates pay off {pays_off}"
+            )
+
+
+if __name__ == "__main__":
+    main()
@@ -1,13 +1,21 @@
 """Script to generate C++ protocol headers from interface definitions."""
 
 import argparse
+import concurrent.futures
+import contextlib
+import functools
 import hashlib
+import json
 import os
 import re
 import subprocess
 import sys
+import tempfile
 from typing import Any
+from typing import Dict
 from typing import List
+from typing import Optional
+from typing import Tuple
 
 import clang.cindex
 from jinja2 import Environment
@@ -25,11 +33,109 @@ except Exception:
     pass
 
 
-def get_method_signature(m: Any) -> str:
+# Part of every cache key. Bump when the generated output changes for reasons
+# that neither the template nor this script's source capture.
+GENERATOR_VERSION = 1
+
+# The options of a single protocol. Together with the preprocessed interface
+# and the template, they determine the generated header.
+PROTOCOL_OPTIONS = (
+    "class_name",
+    "header",
+    "memoize",
+    "unique",
+    "compact",
+    "relative_vtables",
+    "optimize_size",
+    "debug_dispatch",
+    "extern_templates",
+    "instantiate",
+    "type_headers",
+    "module",
+)
+
+# The PROTOCOL_OPTIONS that hold lists. The others are flags.
+LIST_OPTIONS = ("memoize", "instantiate", "type_headers")
+
+# Renders the explicit instantiations of protocols with extern templates. It
+# is looked up next to the protocol template.
+INSTANTIATIONS_TEMPLATE = "protocol_instantiations.j2"
+
+# Renders the module interface unit that exports a generated header. It is
+# looked up next to the protocol template.
+MODULE_TEMPLATE = "protocol_module.j2"
+
+FORMATTERS = ("clang-format", "whitespace", "none")
+
+# The generator only reads declarations.
+FAST_PARSE_OPTIONS = (
+    clang.cindex.TranslationUnit.PARSE_SKIP_FUNCTION_BODIES
+    | clang.cindex.TranslationUnit.PARSE_INCOMPLETE
+)
+
+SYSTEM_INCLUDE_PATTERN = re.compile(r"^\s*#\s*include\s*<([^>]+)>", re.MULTILINE)
+
+
+def get_method_signature(m: Any, ref_qualifier: str = "") -> str:
     """Generate a string signature for a method."""
     args = ",".join(a.type.name for a in m.arguments)
     constness = "const" if m.is_const else ""
-    return f"{m.name}({args}){constness}"
+    return f"{m.name}({args}){constness}{ref_qualifier}"
+
+
+def get_ref_qualifiers(tu: Any, target_class: Any) -> List[str]:
+    """
+    Return the ref-qualifier ("", "&" or "&&") of each method of target_class.
+
+    The model does not record ref-qualifiers, so they are read from the
+    method declarations of the class definition in the translation unit.
+    Raises GenerationError if that definition cannot be matched to the model,
+    rather than generating unqualified methods.
+    """
+    qualifier_spellings = {
+        clang.cindex.RefQualifierKind.LVALUE: "&",
+        clang.cindex.RefQualifierKind.RVALUE: "&&",
+    }
+    class_kinds = (
+        clang.cindex.CursorKind.STRUCT_DECL,
+        clang.cindex.CursorKind.CLASS_DECL,
+    )
+
+    def find_class(cursor: Any, namespace: List[str]) -> Any:
+        for child in cursor.get_children():
+            if (
+                child.kind in class_kinds
+                and child.spelling == target_class.name
+                and "::".join(namespace) == target_class.namespace
+                and child.is_definition()
+            ):
+                return child
+            if child.kind == clang.cindex.CursorKind.NAMESPACE:
+                found = find_class(child, namespace + [child.spelling])
+                if found is not None:
+                    return found
+        return None
+
+    class_cursor = find_class(tu.cursor, [])
+    if class_cursor is None:
+        raise GenerationError(
+            f"Cannot read ref-qualifiers of {target_class.name}: "
+            "class definition not found"
+        )
+    method_cursors = [
+        child
+        for child in class_cursor.get_children()
+        if child.kind == clang.cindex.CursorKind.CXX_METHOD
+    ]
+    if [c.spelling for c in method_cursors] != [m.name for m in target_class.methods]:
+        raise GenerationError(
+            f"Cannot read ref-qualifiers of {target_class.name}: "
+            "its methods do not match the model"
+        )
+    return [
+        qualifier_spellings.get(c.type.get_ref_qualifier(), "")
+        for c in method_cursors
+    ]
 
 
 def get_compiler_args(compiler: str = "c++") -> List[str]:
@@ -64,6 +170,61 @@ def get_compiler_args(compiler: str = "c++") -> List[str]:
     return args
 
 
+def preprocess_interface(
+    compiler: str, input_path: str, output_path: str, depfile: Optional[str]
+) -> str:
+    """
+    Return the preprocessed interface, without comments or line markers.
+
+    When depfile is given, the compiler also writes every header that the
+    interface includes to it, as a dependency of output_path.
+    """
+    cmd = [compiler, "-E", "-P", "-x", "c++", "-std=c++20", input_path]
+    if depfile:
+        os.makedirs(os.path.dirname(os.path.abspath(depfile)), exist_ok=True)
+        cmd += ["-MD", "-MF", depfile, "-MT", output_path]
+    result = subprocess.run(cmd, capture_output=True, text=True)
+    if result.returncode != 0:
+        print(result.stderr, file=sys.stderr)
+        sys.exit(1)
+    return result.stdout
+
+
+def get_cache_key(
+    preprocessed: str, template_paths: List[str], options: Dict[str, Any]
+) -> str:
+    """
+    Hash everything that the generated files depend on.
+
+    The interface is hashed after preprocessing, so changes to comments,
+    formatting or headers that do not affect the interface still hit.
+    """
+    key = hashlib.sha256()
+    key.update(f"{GENERATOR_VERSION}\0".encode())
+    with open(os.path.abspath(__file__), "rb") as f:
+        key.update(hashlib.sha256(f.read()).digest())
+    for template_path in template_paths:
+        with open(template_path, "rb") as f:
+            key.update(hashlib.sha256(f.read()).digest())
+    key.update(json.dumps(options, sort_keys=True).encode())
+    key.update(preprocessed.encode())
+    return key.hexdigest()
+
+
+def write_atomically(path: str, content: bytes) -> None:
+    """Write a file so that concurrent readers never see a partial one."""
+    directory = os.path.dirname(path) or "."
+    os.makedirs(directory, exist_ok=True)
+    fd, temp_path = tempfile.mkstemp(dir=directory, prefix=".tmp-")
+    try:
+        with os.fdopen(fd, "wb") as f:
+            f.write(content)
+        os.replace(temp_path, path)
+    except BaseException:
+        os.unlink(temp_path)
+        raise
+
+
 def mangle_identifier(name: str) -> str:
     """Mangle C++ identifiers (especially operators) for use in C++ code."""
     if name.startswith("operator"):
@@ -116,81 +277,620 @@ def mangle_identifier(name: str) -> str:
     return re.sub(r"[^a-zA-Z0-9_]", "_", name)
 
 
-def main() -> None:
-    """Parse interface and generate protocol header."""
-    parser = argparse.ArgumentParser()
-    parser.add_argument("input", help="Input header file")
-    parser.add_argument("output", help="Output header file")
-    parser.add_argument("--template", help="Jinja template file", default="protocol.j2")
-    parser.add_argument(
-        "--class_name", help="Class name to generate protocol for", required=True
+CHEAP_PARAMETER_TYPES = {
+    "bool",
+    "char",
+    "signed char",
+    "unsigned char",
+    "wchar_t",
+    "char8_t",
+    "char16_t",
+    "char32_t",
+    "short",
+    "unsigned short",
+    "int",
+    "unsigned int",
+    "long",
+    "unsigned long",
+    "long long",
+    "unsigned long long",
+    "float",
+    "double",
+    "long double",
+    "std::size_t",
+    "size_t",
+    "std::ptrdiff_t",
+    "std::nullptr_t",
+    "std::string_view",
+}
+
+
+def vtable_parameter_type(type_name: str) -> str:
+    """
+    Return the type used for a parameter in generated vtable signatures.
+
+    References, pointers, fundamental types and std::string_view are passed
+    unchanged. Other by-value parameters are wrapped in
+    xyz::vtable_parameter_t, which passes them by rvalue reference through the
+    vtable unless they are small and trivially copyable, so they are only
+    materialized at the final call.
+    """
+    name = type_name.strip()
+    if name.endswith(("&", "*")):
+        return type_name
+    unqualified = re.sub(r"\b(const|volatile)\b", "", name).strip()
+    unqualified = re.sub(r"\s+", " ", unqualified)
+    if unqualified in CHEAP_PARAMETER_TYPES or re.fullmatch(
+        r"(std::)?u?int(8|16|32|64|ptr|max)_t", unqualified
+    ):
+        return type_name
+    return f"vtable_parameter_t<{type_name}>"
+
+
+class GenerationError(Exception):
+    """A protocol cannot be generated from its interface."""
+
+
+@functools.lru_cache(maxsize=None)
+def load_template(template_path: str) -> Any:
+    """Load the Jinja2 template once per process."""
+    env = Environment(
+        loader=FileSystemLoader(os.path.dirname(os.path.abspath(template_path))),
+        autoescape=select_autoescape(),
     )
-    parser.add_argument(
-        "--compiler", help="Compiler to use for system include discovery", default="c++"
+    env.filters["mangle"] = mangle_identifier
+    env.filters["vtable_parameter"] = vtable_parameter_type
+    return env.get_template(os.path.basename(template_path))
+
+
+def instantiations_template(template_path: str) -> str:
+    """Return the path of the instantiations template next to template_path."""
+    return os.path.join(os.path.dirname(template_path), INSTANTIATIONS_TEMPLATE)
+
+
+def module_template(template_path: str) -> str:
+    """Return the path of the module template next to template_path."""
+    return os.path.join(os.path.dirname(template_path), MODULE_TEMPLATE)
+
+
+def generated_files(job: Dict[str, Any]) -> Dict[str, str]:
+    """
+    Map a suffix to the path of each file generated for job.
+
+    With extern templates, the explicit instantiations are written next to the
+    header, as protocol_X_instantiations.h and protocol_X_instantiations.cc.
+    A module interface unit is written as protocol_X_module.cc.
+    """
+    files = {".h": job["output"]}
+    stem = os.path.splitext(job["output"])[0]
+    if job["extern_templates"]:
+        for suffix in ("_instantiations.h", "_instantiations.cc"):
+            files[suffix] = stem + suffix
+    if job["module"]:
+        files["_module.cc"] = stem + "_module.cc"
+    return files
+
+
+def restore_cached(
+    job: Dict[str, Any],
+    template_path: str,
+    compiler: str,
+    cache_dir: Optional[str],
+    formatter: str,
+) -> Optional[str]:
+    """
+    Preprocess the interface of job and restore its files from the cache.
+
+    This writes the depfile of job. Returns None when the outputs were
+    restored, and otherwise the path that the generated files should be cached
+    at, before their suffix, or "" without a cache.
+    """
+    if not cache_dir and not job["depfile"]:
+        return ""
+    preprocessed = preprocess_interface(
+        compiler, job["input"], job["output"], job["depfile"]
     )
-    parser.add_argument(
-        "--header",
-        help="Header file to include in the generated protocol",
-        required=True,
+    if not cache_dir:
+        return ""
+    options = {k: job[k] for k in PROTOCOL_OPTIONS}
+    options["formatter"] = formatter
+    template_paths = [template_path]
+    if job["extern_templates"]:
+        template_paths.append(instantiations_template(template_path))
+    if job["module"]:
+        template_paths.append(module_template(template_path))
+    # The instantiations include the header, and the module unit imports it,
+    # by name.
+    if job["extern_templates"] or job["module"]:
+        options["output_name"] = os.path.basename(job["output"])
+    key = get_cache_key(preprocessed, template_paths, options)
+    cache_path = os.path.join(cache_dir, key[:2], key)
+    files = generated_files(job)
+    if not all(os.path.exists(cache_path + suffix) for suffix in files):
+        return cache_path
+    for suffix, path in files.items():
+        with open(cache_path + suffix, "rb") as f:
+            write_atomically(path, f.read())
+    return None
+
+
+def parse_interface(
+    path: str, compiler_args: List[str], preamble: Optional[str] = None
+) -> Any:
+    """
+    Parse an interface with libclang.
+
+    Only declarations matter to the generator, so function bodies are skipped
+    and templates are not instantiated at the end of the translation unit.
+    preamble is a precompiled header of headers that the interface includes.
+    """
+    args = list(compiler_args)
+    if preamble:
+        args += ["-include-pch", preamble]
+    return clang.cindex.Index.create().parse(
+        path, args=args, options=FAST_PARSE_OPTIONS
     )
-    args = parser.parse_args()
 
-    compiler_args = get_compiler_args(compiler=args.compiler)
 
-    index = clang.cindex.Index.create()
-    tu = index.parse(args.input, args=compiler_args)
+def system_includes(path: str) -> List[str]:
+    """Return the headers that the file at path includes with angle brackets."""
+    with open(path) as f:
+        return SYSTEM_INCLUDE_PATTERN.findall(f.read())
+
+
+def build_preamble(
+    headers: List[str], compiler_args: List[str], stem: str
+) -> Optional[str]:
+    """
+    Precompile a header that includes headers, in order, to stem.pch.
+
+    Returns the path of the precompiled header, or None when it cannot be
+    saved.
+    """
+    source = f"{stem}.h"
+    with open(source, "w") as f:
+        f.writelines(f"#include <{h}>\n" for h in headers)
+    tu = clang.cindex.Index.create().parse(
+        source, args=compiler_args + ["-x", "c++-header"], options=FAST_PARSE_OPTIONS
+    )
+    preamble = f"{stem}.pch"
+    try:
+        tu.save(preamble)
+    except clang.cindex.TranslationUnitSaveError:
+        return None
+    return preamble
+
+
+def build_preambles(
+    inputs: List[str], compiler_args: List[str], directory: str
+) -> Dict[str, Optional[str]]:
+    """
+    Return a precompiled preamble, or None, for each of inputs.
+
+    A preamble holds exactly the system headers that an interface includes, in
+    its order, so an interface never parses declarations it did not include
+    itself. Interfaces that include the same headers share one preamble; an
+    include set used by a single interface gets none, as precompiling it would
+    not save a parse.
+    """
+    include_sets: Dict[str, Tuple[str, ...]] = {
+        path: tuple(system_includes(path)) for path in inputs
+    }
+    users: Dict[Tuple[str, ...], int] = {}
+    for headers in include_sets.values():
+        users[headers] = users.get(headers, 0) + 1
+    preambles: Dict[Tuple[str, ...], Optional[str]] = {}
+    for headers, count in users.items():
+        if headers and count > 1:
+            stem = os.path.join(directory, f"preamble_{len(preambles)}")
+            preambles[headers] = build_preamble(list(headers), compiler_args, stem)
+    return {path: preambles.get(headers) for path, headers in include_sets.items()}
+
+
+def tidy_whitespace(source: str) -> str:
+    """Drop the trailing spaces and runs of blank lines that the template leaves."""
+    lines: List[str] = []
+    for line in source.splitlines():
+        line = line.rstrip()
+        if line or (lines and lines[-1]):
+            lines.append(line)
+    return "\n".join(lines).rstrip("\n") + "\n"
+
+
+def generate_uncached(
+    job: Dict[str, Any],
+    cache_path: str,
+    preamble: Optional[str],
+    template_path: str,
+    compiler_args: List[str],
+    formatter: str,
+) -> None:
+    """
+    Parse the interface of job, write its files and cache them.
+
+    preamble is a precompiled header of the system headers the interface
+    includes, or None.
+    """
+    if (job["instantiate"] or job["type_headers"]) and not job["extern_templates"]:
+        raise GenerationError(
+            f"Cannot instantiate {job['class_name']} for concrete types "
+            "without extern templates"
+        )
+
+    tu = parse_interface(job["input"], compiler_args, preamble)
 
     try:
         model = Model(tu)
     except ValueError as e:
-        print(f"Error parsing {args.input}: {e}", file=sys.stderr)
-        sys.exit(1)
+        raise GenerationError(f"Error parsing {job['input']}: {e}") from e
 
     # Find target class
+    class_name = job["class_name"]
     target_class = None
     for c in model.classes:
-        if c.name == args.class_name:
+        if c.name == class_name:
             target_class = c
             break
 
     if not target_class:
-        print(f"Class {args.class_name} not found in {args.input}", file=sys.stderr)
-        sys.exit(1)
+        raise GenerationError(f"Class {class_name} not found in {job['input']}")
 
-    template_dir = os.path.dirname(os.path.abspath(args.template))
-    template_name = os.path.basename(args.template)
-
-    # Setup Jinja2
-    env = Environment(
-        loader=FileSystemLoader(template_dir), autoescape=select_autoescape()
-    )
-    env.filters["mangle"] = mangle_identifier
-    template = env.get_template(template_name)
+    template = load_template(template_path)
 
+    ref_qualifiers = get_ref_qualifiers(tu, target_class)
     method_guids = [
-        hashlib.md5(get_method_signature(m).encode()).hexdigest()[:8]
-        for m in target_class.methods
+        hashlib.md5(get_method_signature(m, ref).encode()).hexdigest()[:8]
+        for m, ref in zip(target_class.methods, ref_qualifiers)
+    ]
+
+    method_names = {m.name for m in target_class.methods}
+    for name in job["memoize"]:
+        if name not in method_names:
+            raise GenerationError(
+                f"Cannot memoize {name}: no such method in {class_name}"
+            )
+    memoized_methods = [m.name in job["memoize"] for m in target_class.methods]
+    for m, memoized in zip(target_class.methods, memoized_methods):
+        if memoized and m.is_const and m.return_type.name == "void":
+            raise GenerationError(f"Cannot memoize {m.name}: method returns void")
+        # The caches hold values, so a cached reference would be a copy.
+        if memoized and m.is_const and m.return_type.name.rstrip().endswith("&"):
+            raise GenerationError(
+                f"Cannot memoize {m.name}: method returns a reference"
+            )
+        # The cached call passes parameters on as lvalues.
+        if memoized and m.is_const:
+            for a in m.arguments:
+                if a.type.name.rstrip().endswith("&&"):
+                    raise GenerationError(
+                        f"Cannot memoize {m.name}: "
+                        f"parameter {a.name} is an rvalue reference"
+                    )
+    # Rvalue-qualified methods consume the object, so they are never cached.
+    memoized_methods = [
+        memoized and ref != "&&"
+        for memoized, ref in zip(memoized_methods, ref_qualifiers)
+    ]
+    # Non-const overloads of a memoized name invalidate the cache instead.
+    memoized_methods = [
+        memoized and m.is_const
+        for m, memoized in zip(target_class.methods, memoized_methods)
     ]
+    if job["memoize"] and not any(memoized_methods):
+        raise GenerationError(
+            f"Cannot memoize {', '.join(job['memoize'])}: no const overloads"
+        )
 
     # Render
-    result = template.render(
-        c=target_class, method_guids=method_guids, header=args.header
+    files = generated_files(job)
+    results = {}
+    results[".h"] = template.render(
+        c=target_class,
+        method_guids=method_guids,
+        memoized_methods=memoized_methods,
+        ref_qualifiers=ref_qualifiers,
+        unique=job["unique"],
+        compact=job["compact"],
+        relative_vtables=job["relative_vtables"],
+        optimize_size=job["optimize_size"],
+        debug_dispatch=job["debug_dispatch"],
+        extern_templates=job["extern_templates"],
+        header=job["header"],
     )
+    if job["extern_templates"]:
+        instantiations = load_template(instantiations_template(template_path))
+        for suffix, definitions in (
+            ("_instantiations.h", False),
+            ("_instantiations.cc", True),
+        ):
+            results[suffix] = instantiations.render(
+                c=target_class,
+                memoized=any(memoized_methods),
+                unique=job["unique"],
+                compact=job["compact"],
+                types=job["instantiate"],
+                type_headers=job["type_headers"],
+                definitions=definitions,
+                header=job["header"],
+                protocol_header=os.path.basename(files[".h"]),
+                instantiations_header=os.path.basename(files["_instantiations.h"]),
+            )
+    if job["module"]:
+        results["_module.cc"] = load_template(module_template(template_path)).render(
+            c=target_class,
+            header=job["header"],
+            protocol_header=os.path.basename(files[".h"]),
+        )
+
+    for suffix, output in files.items():
+        # clang-format matches the checked-in reference header. Tidying
+        # whitespace runs in process and is enough for files that are only
+        # compiled.
+        result = results[suffix]
+        if formatter == "whitespace":
+            result = tidy_whitespace(result)
+        write_atomically(output, result.encode())
+        if formatter == "clang-format":
+            subprocess.run(["clang-format", "-i", output], check=True)
+
+        # Ensure the generated file ends with a trailing newline
+        with open(output, "rb+") as f:
+            content = f.read()
+            if not content.endswith(b"\n"):
+                f.write(b"\n")
+                content += b"\n"
+
+        if cache_path:
+            write_atomically(cache_path + suffix, content)
+
+
+def generate_protocol(
+    job: Dict[str, Any],
+    template_path: str,
+    compiler: str,
+    cache_dir: Optional[str],
+    formatter: str = "clang-format",
+) -> None:
+    """
+    Generate the protocol header, and its instantiations, described by job.
+
+    job holds the input and output paths, an optional depfile and the
+    PROTOCOL_OPTIONS.
+    """
+    cache_path = restore_cached(job, template_path, compiler, cache_dir, formatter)
+    if cache_path is None:
+        return
+    compiler_args = get_compiler_args(compiler=compiler)
+    generate_uncached(job, cache_path, None, template_path, compiler_args, formatter)
+
 
-    output_dir = os.path.dirname(args.output)
-    if output_dir:
-        os.makedirs(output_dir, exist_ok=True)
-    with open(args.output, "w") as f:
-        f.write(result)
+def load_batch(path: str) -> List[Dict[str, Any]]:
+    """
+    Read the protocols of a batch from a JSON list of objects.
+
+    Each object needs "input", "output", "class_name" and "header" and may set
+    the other PROTOCOL_OPTIONS, which default to off or empty.
+    """
+    with open(path) as f:
+        entries = json.load(f)
+    jobs = []
+    for entry in entries:
+        required = ("input", "output", "class_name", "header")
+        missing = [k for k in required if k not in entry]
+        if missing:
+            raise GenerationError(f"{path}: protocol without {', '.join(missing)}")
+        unknown = set(entry) - set(PROTOCOL_OPTIONS) - {"input", "output"}
+        if unknown:
+            names = ", ".join(sorted(unknown))
+            raise GenerationError(f"{path}: unknown keys {names}")
+        job = {k: False for k in PROTOCOL_OPTIONS}
+        job.update({k: [] for k in LIST_OPTIONS})
+        job.update(entry)
+        jobs.append(job)
+    return jobs
+
+
+def generate_batch(
+    jobs: List[Dict[str, Any]],
+    template_path: str,
+    compiler: str,
+    cache_dir: Optional[str],
+    depfile: Optional[str],
+    processes: int,
+    formatter: str = "clang-format",
+) -> None:
+    """
+    Generate several protocols, parsing their interfaces in parallel.
+
+    Cached protocols are restored first. System include paths are discovered
+    once for the rest, and interfaces that include the same system headers
+    share one precompiled preamble of them. The depfile has one rule per
+    output.
+    """
+    with contextlib.ExitStack() as stack:
+        work_dir = stack.enter_context(tempfile.TemporaryDirectory())
+        for i, job in enumerate(jobs):
+            job["depfile"] = os.path.join(work_dir, f"{i}.d") if depfile else None
+
+        processes = min(processes, len(jobs))
+        if processes > 1:
+            pool = stack.enter_context(
+                concurrent.futures.ProcessPoolExecutor(processes)
+            )
+            map_jobs: Any = pool.map
+        else:
+            map_jobs = map
+
+        restore = functools.partial(
+            restore_cached,
+            template_path=template_path,
+            compiler=compiler,
+            cache_dir=cache_dir,
+            formatter=formatter,
+        )
+        cache_paths = list(map_jobs(restore, jobs))
+        misses = [
+            (job, cache_path)
+            for job, cache_path in zip(jobs, cache_paths)
+            if cache_path is not None
+        ]
+        if misses:
+            compiler_args = get_compiler_args(compiler=compiler)
+            preambles = build_preambles(
+                [job["input"] for job, _ in misses], compiler_args, work_dir
+            )
+            generate = functools.partial(
+                generate_uncached,
+                template_path=template_path,
+                compiler_args=compiler_args,
+                formatter=formatter,
+            )
+            for _ in map_jobs(
+                generate,
+                [job for job, _ in misses],
+                [path for _, path in misses],
+                [preambles[job["input"]] for job, _ in misses],
+            ):
+                pass
+
+        if depfile:
+            rules = []
+            for job in jobs:
+                with open(job["depfile"]) as f:
+                    rules.append(f.read().rstrip("\n") + "\n")
+            write_atomically(depfile, "".join(rules).encode())
+
+
+def main() -> None:
+    """Parse interfaces and generate protocol headers."""
+    parser = argparse.ArgumentParser()
+    parser.add_argument("input", nargs="?", help="Input header file")
+    parser.add_argument("output", nargs="?", help="Output header file")
+    parser.add_argument("--template", help="Jinja template file", default="protocol.j2")
+    parser.add_argument("--class_name", help="Class name to generate protocol for")
+    parser.add_argument(
+        "--compiler", help="Compiler to use for system include discovery", default="c++"
+    )
+    parser.add_argument(
+        "--header",
+        help="Header file to include in the generated protocol",
+    )
+    parser.add_argument(
+        "--memoize",
+        help="Const method whose results memoized_protocol should cache",
+        action="append",
+        default=[],
+    )
+    parser.add_argument(
+        "--unique",
+        help="Also generate a move-only unique_protocol specialization",
+        action="store_true",
+    )
+    parser.add_argument(
+        "--compact",
+        help="Also generate compact_protocol and compact_protocol_view",
+        action="store_true",
+    )
+    parser.add_argument(
+        "--relative-vtables",
+        help="Resolve vtable entries through a per-type lookup function",
+        action="store_true",
+    )
+    parser.add_argument(
+        "--optimize-size",
+        help="Share owning vtable entries between interfaces and allocators",
+        action="store_true",
+    )
+    parser.add_argument(
+        "--debug-dispatch",
+        help="Emit named trampolines and forced-inline wrappers for -O0 builds",
+        action="store_true",
+    )
+    parser.add_argument(
+        "--extern-templates",
+        help="Declare the protocols for std::allocator extern and write a source "
+        "file that instantiates them",
+        action="store_true",
+    )
+    parser.add_argument(
+        "--instantiate",
+        help="Concrete type whose vtables the instantiations source defines",
+        action="append",
+        default=[],
+    )
+    parser.add_argument(
+        "--type-header",
+        help="Header that declares the types to --instantiate",
+        dest="type_headers",
+        action="append",
+        default=[],
+    )
+    parser.add_argument(
+        "--module",
+        help="Also write a module interface unit that exports the protocol as "
+        "xyz.protocol.<class name>",
+        action="store_true",
+    )
+    parser.add_argument(
+        "--cache-dir",
+        help="Reuse headers generated from the same preprocessed interface",
+    )
+    parser.add_argument(
+        "--depfile",
+        help="Write the headers that the interface includes as a Makefile rule",
+    )
+    parser.add_argument(
+        "--formatter",
+        help="How to format generated headers",
+        choices=FORMATTERS,
+        default="clang-format",
+    )
+    parser.add_argument(
+        "--batch",
+        help="JSON list of protocols to generate instead of a single interface",
+    )
+    parser.add_argument(
+        "--jobs",
+        help="Processes that parse the interfaces of a batch",
+        type=int,
+        default=os.cpu_count() or 1,
+    )
+    args = parser.parse_args()
 
-    # Format the output file using clang-format
-    subprocess.run(["clang-format", "-i", args.output], check=True)
+    try:
+        if args.batch:
+            jobs = load_batch(args.batch)
+            generate_batch(
+                jobs,
+                args.template,
+                args.compiler,
+                args.cache_dir,
+                args.depfile,
+                args.jobs,
+                args.formatter,
+            )
+            return
 
-    # Ensure the generated file ends with a trailing newline
-    with open(args.output, "rb+") as f:
-        content = f.read()
-        if not content.endswith(b"\n"):
-            f.write(b"\n")
+        missing = [
+            name
+            for name, value in (
+                ("input", args.input),
+                ("output", args.output),
+                ("--class_name", args.class_name),
+                ("--header", args.header),
+            )
+            if not value
+        ]
+        if missing:
+            parser.error(f"the following arguments are required: {', '.join(missing)}")
+        job = {k: getattr(args, k) for k in PROTOCOL_OPTIONS}
+        job.update(input=args.input, output=args.output, depfile=args.depfile)
+        generate_protocol(
+            job, args.template, args.compiler, args.cache_dir, args.formatter
+        )
+    except GenerationError as e:
+        print(e, file=sys.stderr)
+        sys.exit(1)
 
 
 if __name__ == "__main__":
@@ -0,0 +1,192 @@
+"""Time protocol generation for interfaces that include heavy headers."""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+from typing import Callable
+from typing import Dict
+from typing import List
+
+import clang.cindex
+import generate_protocol
+
+# Headers that are expensive to parse and common in service interfaces.
+HEAVY_HEADERS = [
+    "algorithm",
+    "chrono",
+    "filesystem",
+    "functional",
+    "map",
+    "memory",
+    "optional",
+    "regex",
+    "string",
+    "unordered_map",
+    "variant",
+    "vector",
+]
+
+SCRIPTS_DIR = os.path.dirname(os.path.abspath(__file__))
+GENERATOR = os.path.join(SCRIPTS_DIR, "generate_protocol.py")
+TEMPLATE = os.path.join(SCRIPTS_DIR, "protocol.j2")
+
+
+def write_interfaces(directory: str, count: int) -> List[str]:
+    """Write count interfaces that include HEAVY_HEADERS and return their paths."""
+    paths = []
+    for i in range(count):
+        path = os.path.join(directory, f"interface_{i}.h")
+        includes = "".join(f"#include <{h}>\n" for h in HEAVY_HEADERS)
+        with open(path, "w") as f:
+            f.write(
+                f"""{includes}
+struct Interface{i} {{
+  std::string name() const;
+  std::optional<std::chrono::seconds> timeout() const;
+  std::map<std::string, int> counts() const;
+  bool matches(const std::regex& pattern) const;
+  void visit(std::function<void(const std::string&)> visitor);
+  std::variant<int, std::string> lookup(std::string_view key) const;
+  std::vector<std::filesystem::path> files() const;
+}};
+"""
+            )
+        paths.append(path)
+    return paths
+
+
+def best_of(repetitions: int, run: Callable[[], None]) -> float:
+    """Return the fastest wall time of repetitions calls to run, in seconds."""
+    times = []
+    for _ in range(repetitions):
+        start = time.perf_counter()
+        run()
+        times.append(time.perf_counter() - start)
+    return min(times)
+
+
+def time_parsing(
+    inputs: List[str], compiler: str, work_dir: str, repetitions: int
+) -> Dict[str, float]:
+    """Time libclang parses of inputs with each set of parse options."""
+    compiler_args = generate_protocol.get_compiler_args(compiler=compiler)
+
+    def full() -> None:
+        for path in inputs:
+            clang.cindex.Index.create().parse(path, args=compiler_args)
+
+    def skip_bodies() -> None:
+        for path in inputs:
+            generate_protocol.parse_interface(path, compiler_args)
+
+    def with_preamble() -> None:
+        preambles = generate_protocol.build_preambles(inputs, compiler_args, work_dir)
+        for path in inputs:
+            generate_protocol.parse_interface(path, compiler_args, preambles[path])
+
+    return {
+        "parse: default options": best_of(repetitions, full),
+        "parse: skip bodies, incomplete": best_of(repetitions, skip_bodies),
+        "parse: shared preamble": best_of(repetitions, with_preamble),
+    }
+
+
+def time_generation(
+    inputs: List[str],
+    compiler: str,
+    work_dir: str,
+    repetitions: int,
+    formatter: str,
+    jobs: int,
+) -> Dict[str, float]:
+    """Time end-to-end generation with one process per interface and a batch."""
+    common = ["--template", TEMPLATE, "--compiler", compiler]
+    batch = []
+    for i, path in enumerate(inputs):
+        batch.append(
+            {
+                "input": path,
+                "output": os.path.join(work_dir, "out", f"protocol_{i}.h"),
+                "class_name": f"Interface{i}",
+                "header": os.path.basename(path),
+            }
+        )
+    batch_file = os.path.join(work_dir, "batch.json")
+    with open(batch_file, "w") as f:
+        json.dump(batch, f)
+
+    def per_interface(formatter: str) -> Callable[[], None]:
+        def run() -> None:
+            for entry in batch:
+                subprocess.run(
+                    [sys.executable, GENERATOR, entry["input"], entry["output"]]
+                    + ["--class_name", entry["class_name"]]
+                    + ["--header", entry["header"], "--formatter", formatter]
+                    + common,
+                    check=True,
+                )
+
+        return run
+
+    def batched() -> None:
+        subprocess.run(
+            [sys.executable, GENERATOR, "--batch", batch_file, "--jobs", str(jobs)]
+            + ["--formatter", formatter]
+            + common,
+            check=True,
+        )
+
+    return {
+        "generate: process per interface, clang-format": best_of(
+            repetitions, per_interface("clang-format")
+        ),
+        f"generate: process per interface, {formatter}": best_of(
+            repetitions, per_interface(formatter)
+        ),
+        f"generate: batch of {len(inputs)}, {formatter}": best_of(
+            repetitions, batched
+        ),
+    }
+
+
+def main() -> None:
+    """Print generation times for synthetic interfaces with heavy includes."""
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--compiler", default="c++", help="Compiler for includes")
+    parser.add_argument("--interfaces", type=int, default=8, help="Interfaces")
+    parser.add_argument("--repetitions", type=int, default=3, help="Best of")
+    parser.add_argument(
+        "--formatter",
+        choices=generate_protocol.FORMATTERS,
+        default="whitespace",
+        help="Formatter of the batched run",
+    )
+    parser.add_argument(
+        "--jobs", type=int, default=os.cpu_count() or 1, help="Batch processes"
+    )
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as work_dir:
+        inputs = write_interfaces(work_dir, args.interfaces)
+        results = time_parsing(inputs, args.compiler, work_dir, args.repetitions)
+        results.update(
+            time_generation(
+                inputs,
+                args.compiler,
+                work_dir,
+                args.repetitions,
+                args.formatter,
+                args.jobs,
+            )
+        )
+    width = max(len(name) for name in results)
+    for name, seconds in results.items():
+        print(f"{name:<{width}}  {seconds * 1000:>9.1f} ms")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,212 @@
+"""Compare compile times of a translation unit that includes or imports protocols."""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+from typing import List
+from typing import Tuple
+
+from extern_template_benchmark import break_even
+
+SCRIPTS_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(SCRIPTS_DIR)
+GENERATOR = os.path.join(SCRIPTS_DIR, "generate_protocol.py")
+TEMPLATE = os.path.join(SCRIPTS_DIR, "protocol.j2")
+
+# The standard headers that protocol.h and generated headers include. As header
+# units, every other header unit imports them instead of carrying a copy.
+STANDARD_HEADERS = [
+    "atomic",
+    "cassert",
+    "concepts",
+    "cstddef",
+    "cstdint",
+    "cstring",
+    "functional",
+    "initializer_list",
+    "memory",
+    "mutex",
+    "new",
+    "thread",
+    "type_traits",
+    "utility",
+]
+
+
+def write_interfaces(directory: str, count: int, methods: int) -> List[str]:
+    """Write count interfaces with methods methods each and return their names."""
+    names = []
+    for i in range(count):
+        name = f"Interface{i}"
+        declarations = "".join(
+            f"  int m{j}(int x) const;\n" if j % 2 == 0 else f"  void m{j}(int x);\n"
+            for j in range(methods)
+        )
+        with open(os.path.join(directory, f"interface_{name}.h"), "w") as f:
+            f.write(f"#pragma once\n\nstruct {name} {{\n{declarations}}};\n")
+        names.append(name)
+    return names
+
+
+def use_source(names: List[str], methods: int, preamble: str) -> str:
+    """Return a translation unit that stores a concrete type in each protocol."""
+    definitions = "".join(
+        f"  int m{j}(int x) const {{ return x + {j}; }}\n"
+        if j % 2 == 0
+        else f"  void m{j}(int) {{}}\n"
+        for j in range(methods)
+    )
+    uses = "".join(
+        f"  total += xyz::protocol<{name}>(std::in_place_type<Impl>).m0(1);\n"
+        for name in names
+    )
+    return f"""{preamble}
+struct Impl {{
+{definitions}}};
+
+int use() {{
+  int total = 0;
+{uses}  return total;
+}}
+"""
+
+
+def run(command: List[str], work_dir: str) -> float:
+    """Run command in work_dir and return its wall time in seconds."""
+    start = time.perf_counter()
+    subprocess.run(command, cwd=work_dir, check=True)
+    return time.perf_counter() - start
+
+
+def best_of(command: List[str], work_dir: str, repetitions: int) -> float:
+    """Return the fastest of repetitions runs of command."""
+    return min(run(command, work_dir) for _ in range(repetitions))
+
+
+def build_modules(
+    compiler: str, flags: List[str], names: List[str], work_dir: str, build_dir: str
+) -> Tuple[float, int]:
+    """
+    Build the module interfaces in build_dir and return the time and their size.
+
+    The standard headers, protocol.h and each generated header in work_dir
+    become header units, and the named modules export them.
+    """
+    headers = [os.path.join(REPO_DIR, "protocol.h")] + [
+        os.path.join(work_dir, f"protocol_{name}.h") for name in names
+    ]
+    units = [os.path.join(REPO_DIR, "protocol_module.cc")] + [
+        os.path.join(work_dir, f"protocol_{name}_module.cc") for name in names
+    ]
+    seconds = 0.0
+    for header in STANDARD_HEADERS:
+        seconds += run(
+            [compiler, *flags, "-fmodule-header=system", "-x", "c++-system-header"]
+            + [header],
+            build_dir,
+        )
+    for header in headers:
+        seconds += run(
+            [compiler, *flags, "-fmodule-header", "-x", "c++-user-header", header],
+            build_dir,
+        )
+    for unit in units:
+        seconds += run([compiler, *flags, "-c", unit, "-o", os.devnull], build_dir)
+    size = 0
+    for root, _, files in os.walk(os.path.join(build_dir, "gcm.cache")):
+        size += sum(os.path.getsize(os.path.join(root, f)) for f in files)
+    return seconds, size
+
+
+def main() -> None:
+    """Print compile times of one translation unit with headers and modules."""
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--compiler", default="g++", help="C++ compiler")
+    parser.add_argument(
+        "--protocols", type=int, default=50, help="Protocols the TU uses"
+    )
+    parser.add_argument("--methods", type=int, default=8, help="Methods each")
+    parser.add_argument(
+        "--optimization",
+        action="append",
+        help="Optimization flag; defaults to -O0 and -O2",
+    )
+    parser.add_argument("--repetitions", type=int, default=3, help="Best of")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as work_dir:
+        names = write_interfaces(work_dir, args.protocols, args.methods)
+        batch = [
+            {
+                "input": os.path.join(work_dir, f"interface_{name}.h"),
+                "output": os.path.join(work_dir, f"protocol_{name}.h"),
+                "class_name": name,
+                "header": f"interface_{name}.h",
+                "module": True,
+            }
+            for name in names
+        ]
+        manifest = os.path.join(work_dir, "protocols.json")
+        with open(manifest, "w") as f:
+            json.dump(batch, f)
+        subprocess.run(
+            [sys.executable, GENERATOR, "--batch", manifest, "--template", TEMPLATE]
+            + ["--compiler", args.compiler, "--formatter", "whitespace"],
+            check=True,
+        )
+
+        includes = "#include <utility>\n\n" + "".join(
+            f'#include "protocol_{name}.h"\n' for name in names
+        )
+        imports = "".join(f"import xyz.protocol.{name};\n" for name in names)
+        header_tu = os.path.join(work_dir, "use_headers.cc")
+        with open(header_tu, "w") as f:
+            f.write(use_source(names, args.methods, includes))
+        module_tu = os.path.join(work_dir, "use_modules.cc")
+        with open(module_tu, "w") as f:
+            f.write(use_source(names, args.methods, imports))
+
+        output = os.path.join(work_dir, "use.o")
+        for optimization in args.optimization or ["-O0", "-O2"]:
+            flags = ["-std=c++20", optimization, f"-I{REPO_DIR}", f"-I{work_dir}"]
+            module_flags = [*flags, "-fmodules-ts"]
+            # Module interfaces must be imported with the flags they were built
+            # with, so each optimization level has its own gcm.cache.
+            build_dir = os.path.join(work_dir, optimization.lstrip("-"))
+            os.makedirs(build_dir)
+            headers = best_of(
+                [args.compiler, *flags, "-c", header_tu, "-o", output],
+                work_dir,
+                args.repetitions,
+            )
+            interfaces, interface_size = build_modules(
+                args.compiler, module_flags, names, work_dir, build_dir
+            )
+            modules = best_of(
+                [args.compiler, *module_flags, "-c", module_tu, "-o", output],
+                build_dir,
+                args.repetitions,
+            )
+
+            units_to_pay_off = break_even(headers, modules, interfaces)
+            pays_off = (
+                f"from {units_to_pay_off} translation units"
+                if units_to_pay_off is not None
+                else "never"
+            )
+            print(f"{optimization}, {args.protocols} protocols")
+            print(f"  #include            {headers:7.2f} s per TU")
+            print(f"  import              {modules:7.2f} s per TU")
+            print(
+                f"  module interfaces   {interfaces:7.2f} s once"
+                f"  {interface_size // (1024 * 1024):6} MiB"
+            )
+            print(f"  modules pay off {pays_off}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,79 @@
+"""Tests for the compile-time scalability benchmark."""
+
+from typing import Any
+from typing import Dict
+
+from scripts.compile_time_benchmark import chain_source
+from scripts.compile_time_benchmark import compare
+from scripts.compile_time_benchmark import grid_source
+from scripts.compile_time_benchmark import interface_source
+
+
+def point(name: str, **metrics: float) -> Dict[str, Any]:
+    """Return a completed point with the given metrics."""
+    values: Dict[str, Any] = {
+        "generator_seconds": 1.0,
+        "compile_seconds": 10.0,
+        "peak_memory_kib": 100000,
+        "object_bytes": 100000,
+    }
+    values.update(metrics)
+    return {"name": name, "status": "ok", **values}
+
+
+def test_interface_source() -> None:
+    """Test that synthetic interfaces mix const and non-const methods."""
+    source = interface_source("Synthetic", [0, 1])
+    assert "struct Synthetic {" in source
+    assert "int m0(int x) const;" in source
+    assert "void m1(int x);" in source
+
+
+def test_grid_source() -> None:
+    """Test that the translation unit instantiates every concrete type."""
+    source = grid_source(3, 50)
+    assert '#include "protocol_Synthetic.h"' in source
+    assert "std::make_integer_sequence<int, 50>" in source
+    assert "void m1(int x) { value += x + 1; }" in source
+    assert "m3" not in source
+
+
+def test_chain_source() -> None:
+    """Test that every step of a chain narrows the previous protocol."""
+    source = chain_source(2)
+    assert '#include "protocol_Chain2.h"' in source
+    assert "xyz::protocol<Chain1, Allocator> p1(std::move(p0));" in source
+    assert "xyz::protocol<Chain2, Allocator> p2(std::move(p1));" in source
+    assert "return p2.m0(1);" in source
+
+
+def test_compare() -> None:
+    """Test that only growth beyond tolerance and noise is a regression."""
+    baseline = {
+        "points": [
+            point("a"),
+            point("b"),
+            point("c"),
+            {"name": "d", "status": "compiler timeout"},
+        ]
+    }
+    results = {
+        "points": [
+            point("a", compile_seconds=12.0),
+            point("b", compile_seconds=13.0, object_bytes=101000),
+            {"name": "c", "status": "compiler timeout"},
+            {"name": "d", "status": "compiler timeout"},
+            point("e"),
+        ]
+    }
+    assert compare(baseline, results, 0.25) == [
+        "b: compile_seconds 10.0 -> 13.0",
+        "c: compiler timeout",
+    ]
+
+
+def test_compare_ignores_noise() -> None:
+    """Test that small metrics may grow by more than tolerance."""
+    baseline = {"points": [point("a", generator_seconds=0.05)]}
+    results = {"points": [point("a", generator_seconds=0.1)]}
+    assert compare(baseline, results, 0.25) == []
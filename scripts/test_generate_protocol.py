@@ -6,11 +6,14 @@ correctly parses C++ interfaces and generates the corresponding protocol
 header files. It uses libclang via xyz-cppmodel for structural verification.
 """
 
+import json
 import os
+import re
 import shutil
 import subprocess
 import sys
 import tempfile
+import types
 from typing import Generator
 from typing import List
 from typing import Optional
@@ -19,7 +22,10 @@ import clang.cindex
 import pytest
 from xyz.cppmodel import Model
 
+from scripts.generate_protocol import GenerationError
+from scripts.generate_protocol import build_preambles
 from scripts.generate_protocol import get_compiler_args
+from scripts.generate_protocol import get_ref_qualifiers
 
 # Try to set the library path explicitly for environments like Bazel
 # where LD_LIBRARY_PATH isn't carried over
@@ -189,6 +195,822 @@ def test_class_not_found(temp_dir: str, compiler: str) -> None:
     assert "Class Missing not found" in res.stderr
 
 
+def test_memoize_rejects_invalid_methods(temp_dir: str, compiler: str) -> None:
+    """Test that --memoize only accepts const methods that can be cached."""
+    input_header = os.path.join(temp_dir, "input.h")
+    output_header = os.path.join(temp_dir, "output.h")
+
+    with open(input_header, "w") as f:
+        f.write(
+            """
+        class Simple {
+        public:
+            void reset() const;
+            const int& ref() const;
+            int take(int&& x) const;
+            int bar(int x);
+            int baz() const;
+        };
+        """
+        )
+
+    for name, message in [
+        ("missing", "no such method"),
+        ("reset", "method returns void"),
+        ("ref", "method returns a reference"),
+        ("take", "parameter x is an rvalue reference"),
+        ("bar", "no const overloads"),
+    ]:
+        res = run_generate_protocol(
+            input_header,
+            output_header,
+            "Simple",
+            "input.h",
+            extra_args=["--memoize", name],
+            compiler=compiler,
+        )
+        assert res.returncode != 0
+        assert f"Cannot memoize {name}" in res.stderr
+        assert message in res.stderr
+
+    res = run_generate_protocol(
+        input_header,
+        output_header,
+        "Simple",
+        "input.h",
+        extra_args=["--memoize", "baz"],
+        compiler=compiler,
+    )
+    assert res.returncode == 0, res.stderr
+    with open(output_header) as f:
+        assert "class memoized_protocol<Simple, Allocator>" in f.read()
+
+
+def test_vtable_parameter_passing(temp_dir: str, compiler: str) -> None:
+    """Test that only expensive by-value parameters are forwarded by reference."""
+    input_header = os.path.join(temp_dir, "input.h")
+    output_header = os.path.join(temp_dir, "output.h")
+
+    with open(input_header, "w") as f:
+        f.write(
+            """
+        #include <string>
+        class Simple {
+        public:
+            int by_value(std::string s, int x) const;
+            int by_reference(const std::string& s, const char* p) const;
+        };
+        """
+        )
+
+    res = run_generate_protocol(
+        input_header, output_header, "Simple", "input.h", compiler=compiler
+    )
+    assert res.returncode == 0, res.stderr
+
+    with open(output_header) as f:
+        content = f.read()
+
+    assert "vtable_parameter_t<std::string> a0, int a1" in content
+    assert "vtable_parameter_t<const std::string &>" not in content
+    assert "vtable_parameter_t<const char *>" not in content
+    # Wrappers keep the interface signature.
+    assert "int by_value(std::string a0, int a1) const" in content
+
+
+def test_ref_qualified_methods(temp_dir: str, compiler: str) -> None:
+    """Test that & and && qualified methods keep their qualifiers."""
+    input_header = os.path.join(temp_dir, "input.h")
+    output_header = os.path.join(temp_dir, "output.h")
+
+    with open(input_header, "w") as f:
+        f.write(
+            """
+        class Simple {
+        public:
+            int get() const &;
+            int get() &&;
+        };
+        """
+        )
+
+    res = run_generate_protocol(
+        input_header, output_header, "Simple", "input.h", compiler=compiler
+    )
+    assert res.returncode == 0, res.stderr
+
+    with open(output_header) as f:
+        content = f.read()
+
+    assert re.search(r"int get\(\) const &\s*\{", content)
+    assert re.search(r"int get\(\) &&\s*\{", content)
+    assert "std::move(*static_cast<T*>(ptr)).get()" in content
+    # Overloads that differ only by ref-qualifier get distinct vtable slots.
+    slots = set(re.findall(r"get_[0-9a-f]{8}", content))
+    assert len(slots) == 2
+
+
+def parse_ref_qualifier_input(
+    temp_dir: str, compiler: str
+) -> clang.cindex.TranslationUnit:
+    """Parse two classes named Simple whose methods differ in ref-qualifiers."""
+    input_header = os.path.join(temp_dir, "input.h")
+    with open(input_header, "w") as f:
+        f.write(
+            """
+        namespace a {
+        class Simple {
+        public:
+            int get() const &;
+        };
+        }
+        namespace b {
+        class Simple {
+        public:
+            int get() &&;
+        };
+        }
+        """
+        )
+    return clang.cindex.Index.create().parse(
+        input_header, args=get_compiler_args(compiler)
+    )
+
+
+def test_ref_qualifiers_match_namespace(temp_dir: str, compiler: str) -> None:
+    """Test that ref-qualifiers are read from the class in the right namespace."""
+    tu = parse_ref_qualifier_input(temp_dir, compiler)
+    methods = [types.SimpleNamespace(name="get")]
+    for namespace, qualifier in [("a", "&"), ("b", "&&")]:
+        target_class = types.SimpleNamespace(
+            name="Simple", namespace=namespace, methods=methods
+        )
+        assert get_ref_qualifiers(tu, target_class) == [qualifier]
+
+
+def test_ref_qualifiers_unmatched_class(temp_dir: str, compiler: str) -> None:
+    """Test that a class the model does not match is an error."""
+    tu = parse_ref_qualifier_input(temp_dir, compiler)
+    missing = types.SimpleNamespace(
+        name="Simple", namespace="c", methods=[types.SimpleNamespace(name="get")]
+    )
+    with pytest.raises(GenerationError, match="class definition not found"):
+        get_ref_qualifiers(tu, missing)
+    renamed = types.SimpleNamespace(
+        name="Simple", namespace="a", methods=[types.SimpleNamespace(name="set")]
+    )
+    with pytest.raises(GenerationError, match="do not match the model"):
+        get_ref_qualifiers(tu, renamed)
+
+
+def test_unique_protocol_generation(temp_dir: str, compiler: str) -> None:
+    """Test that --unique emits a unique_protocol without a clone entry."""
+    input_header = os.path.join(temp_dir, "input.h")
+    output_header = os.path.join(temp_dir, "output.h")
+
+    with open(input_header, "w") as f:
+        f.write(
+            """
+        class Simple {
+        public:
+            int get() const;
+        };
+        """
+        )
+
+    res = run_generate_protocol(
+        input_header, output_header, "Simple", "input.h", compiler=compiler
+    )
+    assert res.returncode == 0, res.stderr
+    with open(output_header) as f:
+        assert "class unique_protocol<" not in f.read()
+
+    res = run_generate_protocol(
+        input_header,
+        output_header,
+        "Simple",
+        "input.h",
+        extra_args=["--unique"],
+        compiler=compiler,
+    )
+    assert res.returncode == 0, res.stderr
+    with open(output_header) as f:
+        content = f.read()
+
+    assert "class unique_protocol<Simple, Allocator>" in content
+    assert "unique_protocol_owning_vtable_traits<Simple, Allocator>" in content
+
+
+def test_compact_protocol_generation(temp_dir: str, compiler: str) -> None:
+    """Test that --compact emits compact_protocol and compact_protocol_view."""
+    input_header = os.path.join(temp_dir, "input.h")
+    output_header = os.path.join(temp_dir, "output.h")
+
+    with open(input_header, "w") as f:
+        f.write(
+            """
+        class Simple {
+        public:
+            int get() const;
+        };
+        """
+        )
+
+    res = run_generate_protocol(
+        input_header, output_header, "Simple", "input.h", compiler=compiler
+    )
+    assert res.returncode == 0, res.stderr
+    with open(output_header) as f:
+        assert "class compact_protocol<" not in f.read()
+
+    res = run_generate_protocol(
+        input_header,
+        output_header,
+        "Simple",
+        "input.h",
+        extra_args=["--compact"],
+        compiler=compiler,
+    )
+    assert res.returncode == 0, res.stderr
+    with open(output_header) as f:
+        content = f.read()
+
+    assert "class compact_protocol<Simple>" in content
+    assert "class compact_protocol_view<Simple>" in content
+
+
+def test_relative_vtables_generation(temp_dir: str, compiler: str) -> None:
+    """Test that --relative-vtables replaces entry pointers with a lookup."""
+    input_header = os.path.join(temp_dir, "input.h")
+    output_header = os.path.join(temp_dir, "output.h")
+
+    with open(input_header, "w") as f:
+        f.write(
+            """
+        class Simple {
+        public:
+            int get() const;
+            void set(int value);
+        };
+        """
+        )
+
+    res = run_generate_protocol(
+        input_header, output_header, "Simple", "input.h", compiler=compiler
+    )
+    assert res.returncode == 0, res.stderr
+    with open(output_header) as f:
+        assert "xyz_protocol_lookup" not in f.read()
+
+    res = run_generate_protocol(
+        input_header,
+        output_header,
+        "Simple",
+        "input.h",
+        extra_args=["--relative-vtables"],
+        compiler=compiler,
+    )
+    assert res.returncode == 0, res.stderr
+    with open(output_header) as f:
+        content = f.read()
+
+    assert "relative_vtable_lookup xyz_protocol_lookup;" in content
+    assert "const void* view_vtable_Simple_lookup(" in content
+    assert "type_token xyz_protocol_type;" not in content
+
+
+def test_optimize_size_generation(temp_dir: str, compiler: str) -> None:
+    """Test that --optimize-size uses the shared lifetime entries."""
+    input_header = os.path.join(temp_dir, "input.h")
+    output_header = os.path.join(temp_dir, "output.h")
+
+    with open(input_header, "w") as f:
+        f.write(
+            """
+        class Simple {
+        public:
+            int get() const;
+        };
+        """
+        )
+
+    res = run_generate_protocol(
+        input_header, output_header, "Simple", "input.h", compiler=compiler
+    )
+    assert res.returncode == 0, res.stderr
+    with open(output_header) as f:
+        assert "protocol_lifetime" not in f.read()
+
+    res = run_generate_protocol(
+        input_header,
+        output_header,
+        "Simple",
+        "input.h",
+        extra_args=["--optimize-size", "--unique"],
+        compiler=compiler,
+    )
+    assert res.returncode == 0, res.stderr
+    with open(output_header) as f:
+        content = f.read()
+
+    lifetime = "protocol_lifetime<T, protocol_thunk_allocator_t<Allocator>>"
+    assert f"&{lifetime}::clone" in content
+    assert "const protocol_thunk_allocator_t<Allocator>& alloc);" in content
+    assert "static void* xyz_protocol_clone(void* cb" not in content
+
+
+def test_debug_dispatch_generation(temp_dir: str, compiler: str) -> None:
+    """Test that --debug-dispatch emits named trampolines and inline hints."""
+    input_header = os.path.join(temp_dir, "input.h")
+    output_header = os.path.join(temp_dir, "output.h")
+
+    with open(input_header, "w") as f:
+        f.write(
+            """
+        #include <string>
+        class Simple {
+        public:
+            int get(std::string s) const;
+            void take() &&;
+        };
+        """
+        )
+
+    res = run_generate_protocol(
+        input_header, output_header, "Simple", "input.h", compiler=compiler
+    )
+    assert res.returncode == 0, res.stderr
+    with open(output_header) as f:
+        content = f.read()
+    assert "_trampolines" not in content
+    assert "XYZ_PROTOCOL_ALWAYS_INLINE" not in content
+
+    res = run_generate_protocol(
+        input_header,
+        output_header,
+        "Simple",
+        "input.h",
+        extra_args=["--debug-dispatch"],
+        compiler=compiler,
+    )
+    assert res.returncode == 0, res.stderr
+    with open(output_header) as f:
+        content = f.read()
+
+    assert "struct view_vtable_Simple_trampolines" in content
+    assert "&view_vtable_Simple_trampolines<T>::get_" in content
+    assert "static_cast<decltype(a0)&&>(a0)" in content
+    assert "static_cast<T&&>(*static_cast<T*>(ptr)).take()" in content
+    assert "XYZ_PROTOCOL_ALWAYS_INLINE int get(" in content
+    assert "std::forward<decltype(a0)>" not in content
+    assert "[](" not in content
+
+
+def test_extern_templates_generation(temp_dir: str, compiler: str) -> None:
+    """Test that --extern-templates writes instantiations that link and run."""
+    input_header = os.path.join(temp_dir, "input.h")
+    output_header = os.path.join(temp_dir, "protocol_Simple.h")
+    with open(input_header, "w") as f:
+        # The interface is never defined, as in a real interface header.
+        f.write("class Simple {\npublic:\n  int get() const;\n};\n")
+    with open(os.path.join(temp_dir, "impl.h"), "w") as f:
+        f.write("namespace impl {\nstruct Impl {\n")
+        f.write("  int get() const { return 7; }\n};\n}  // namespace impl\n")
+
+    res = run_generate_protocol(
+        input_header,
+        output_header,
+        "Simple",
+        "input.h",
+        extra_args=["--instantiate", "impl::Impl", "--type-header", "impl.h"],
+        compiler=compiler,
+    )
+    assert res.returncode != 0
+    assert "without extern templates" in res.stderr
+
+    res = run_generate_protocol(
+        input_header,
+        output_header,
+        "Simple",
+        "input.h",
+        extra_args=[
+            "--extern-templates",
+            "--unique",
+            "--instantiate",
+            "impl::Impl",
+            "--type-header",
+            "impl.h",
+        ],
+        compiler=compiler,
+    )
+    assert res.returncode == 0, res.stderr
+    with open(output_header) as f:
+        content = f.read()
+    assert (
+        "extern template class protocol<Simple, std::allocator<Simple>>;" in content
+    )
+    assert "extern template class unique_protocol<Simple," in content
+    instantiations_header = os.path.join(temp_dir, "protocol_Simple_instantiations.h")
+    instantiations_source = os.path.join(temp_dir, "protocol_Simple_instantiations.cc")
+    with open(instantiations_header) as f:
+        content = f.read()
+    assert '#include "impl.h"' in content
+    assert (
+        "extern template struct protocol<Simple, std::allocator<Simple>>"
+        "::vtable_impl<impl::Impl>;" in content
+    )
+    with open(instantiations_source) as f:
+        content = f.read()
+    assert "template class protocol<Simple, std::allocator<Simple>>;" in content
+    assert "extern template" not in content
+
+    main_cc = os.path.join(temp_dir, "main.cc")
+    with open(main_cc, "w") as f:
+        f.write(
+            '#include "protocol_Simple_instantiations.h"\n'
+            "int main() {\n"
+            "  xyz::protocol<Simple> p(impl::Impl{});\n"
+            "  auto copy = p;\n"
+            "  return copy.get() == 7 ? 0 : 1;\n"
+            "}\n"
+        )
+    executable = os.path.join(temp_dir, "main")
+    comp_res = subprocess.run(
+        [compiler, "-std=c++20", "-pthread", "-I.", f"-I{temp_dir}"]
+        + [main_cc, instantiations_source, "protocol.cc", "-o", executable],
+        capture_output=True,
+        text=True,
+    )
+    assert comp_res.returncode == 0, f"Compilation failed:\n{comp_res.stderr}"
+    assert subprocess.run([executable]).returncode == 0
+
+
+def test_instantiations_cache_keeps_output_names(temp_dir: str, compiler: str) -> None:
+    """Test that cached instantiations are not restored under another name."""
+    input_header = os.path.join(temp_dir, "input.h")
+    cache_dir = os.path.join(temp_dir, "cache")
+    with open(input_header, "w") as f:
+        f.write("class Simple {\npublic:\n  int get() const;\n};\n")
+
+    for name in ("protocol_A", "other_name"):
+        res = run_generate_protocol(
+            input_header,
+            os.path.join(temp_dir, f"{name}.h"),
+            "Simple",
+            "input.h",
+            extra_args=["--extern-templates", "--cache-dir", cache_dir],
+            compiler=compiler,
+        )
+        assert res.returncode == 0, res.stderr
+        with open(os.path.join(temp_dir, f"{name}_instantiations.h")) as f:
+            assert f'#include "{name}.h"' in f.read()
+        with open(os.path.join(temp_dir, f"{name}_instantiations.cc")) as f:
+            assert f'#include "{name}_instantiations.h"' in f.read()
+
+
+def test_module_generation(temp_dir: str, compiler: str) -> None:
+    """Test that --module writes a unit that exports the generated header."""
+    input_header = os.path.join(temp_dir, "input.h")
+    output_header = os.path.join(temp_dir, "protocol_Simple.h")
+    module_unit = os.path.join(temp_dir, "protocol_Simple_module.cc")
+    with open(input_header, "w") as f:
+        f.write("class Simple {\npublic:\n  int get() const;\n};\n")
+
+    res = run_generate_protocol(
+        input_header, output_header, "Simple", "input.h", compiler=compiler
+    )
+    assert res.returncode == 0, res.stderr
+    assert not os.path.exists(module_unit)
+
+    res = run_generate_protocol(
+        input_header,
+        output_header,
+        "Simple",
+        "input.h",
+        extra_args=["--module"],
+        compiler=compiler,
+    )
+    assert res.returncode == 0, res.stderr
+    with open(module_unit) as f:
+        content = f.read()
+    assert "export module xyz.protocol.Simple;" in content
+    assert "export import xyz.protocol;" in content
+    assert 'export import "protocol_Simple.h";' in content
+
+
+def test_module_cache_keeps_output_names(temp_dir: str, compiler: str) -> None:
+    """Test that a cached module unit is not restored under another name."""
+    input_header = os.path.join(temp_dir, "input.h")
+    cache_dir = os.path.join(temp_dir, "cache")
+    with open(input_header, "w") as f:
+        f.write("class Simple {\npublic:\n  int get() const;\n};\n")
+
+    for name in ("protocol_A", "other_name"):
+        res = run_generate_protocol(
+            input_header,
+            os.path.join(temp_dir, f"{name}.h"),
+            "Simple",
+            "input.h",
+            extra_args=["--module", "--cache-dir", cache_dir],
+            compiler=compiler,
+        )
+        assert res.returncode == 0, res.stderr
+        with open(os.path.join(temp_dir, f"{name}_module.cc")) as f:
+            assert f'export import "{name}.h";' in f.read()
+
+
+def test_cache_skips_unchanged_interfaces(temp_dir: str, compiler: str) -> None:
+    """Test that --cache-dir reuses the header of an unchanged interface."""
+    input_header = os.path.join(temp_dir, "input.h")
+    output_header = os.path.join(temp_dir, "output.h")
+    cache_dir = os.path.join(temp_dir, "cache")
+
+    def generate(source: str, extra_args: Optional[List[str]] = None) -> str:
+        with open(input_header, "w") as f:
+            f.write(source)
+        res = run_generate_protocol(
+            input_header,
+            output_header,
+            "Simple",
+            "input.h",
+            extra_args=["--cache-dir", cache_dir] + (extra_args or []),
+            compiler=compiler,
+        )
+        assert res.returncode == 0, res.stderr
+        with open(output_header) as f:
+            return f.read()
+
+    def cache_entries() -> List[str]:
+        return [
+            os.path.join(root, name)
+            for root, _, names in os.walk(cache_dir)
+            for name in names
+        ]
+
+    source = "class Simple {\npublic:\n  int get() const;\n};\n"
+    generated = generate(source)
+    entries = cache_entries()
+    assert len(entries) == 1
+    with open(entries[0]) as f:
+        assert f.read() == generated
+
+    # A hit copies the entry without parsing the interface, so a marker
+    # appended to the entry shows up in the output.
+    with open(entries[0], "a") as f:
+        f.write("// cached\n")
+    assert generate("// Comments are not part of the key.\n" + source).endswith(
+        "// cached\n"
+    )
+
+    assert "// cached" not in generate(source, extra_args=["--unique"])
+    changed = source.replace("int get() const;", "int get() const;\n  void set();")
+    assert "set()" in generate(changed)
+    assert len(cache_entries()) == 3
+
+
+def test_depfile_lists_included_headers(temp_dir: str, compiler: str) -> None:
+    """Test that --depfile lists every header the interface includes."""
+    input_header = os.path.join(temp_dir, "input.h")
+    output_header = os.path.join(temp_dir, "output.h")
+    dependency = os.path.join(temp_dir, "dependency.h")
+    depfile = output_header + ".d"
+
+    with open(dependency, "w") as f:
+        f.write("#include <string>\nusing Name = std::string;\n")
+    with open(input_header, "w") as f:
+        f.write(
+            """
+        #include "dependency.h"
+        class Simple {
+        public:
+            Name get() const;
+        };
+        """
+        )
+
+    res = run_generate_protocol(
+        input_header,
+        output_header,
+        "Simple",
+        "input.h",
+        extra_args=["--depfile", depfile],
+        compiler=compiler,
+    )
+    assert res.returncode == 0, res.stderr
+    with open(depfile) as f:
+        content = f.read()
+    assert content.startswith(f"{output_header}:")
+    assert input_header in content
+    assert dependency in content
+    # System headers are listed too, so a toolchain update regenerates.
+    assert "string" in content.replace(dependency, "")
+
+
+def test_batch_generation(temp_dir: str, compiler: str) -> None:
+    """Test that --batch generates several protocols in one invocation."""
+    interfaces = {
+        "Simple": "class Simple {\npublic:\n  int get() const;\n};\n",
+        "Other": "#include <string>\nstruct Other {\n  std::string name() const;\n};\n",
+    }
+    batch = []
+    for class_name, source in interfaces.items():
+        input_header = os.path.join(temp_dir, f"{class_name}.h")
+        with open(input_header, "w") as f:
+            f.write(source)
+        batch.append(
+            {
+                "input": input_header,
+                "output": os.path.join(temp_dir, "batch", f"protocol_{class_name}.h"),
+                "class_name": class_name,
+                "header": f"{class_name}.h",
+                "unique": class_name == "Other",
+            }
+        )
+    batch_file = os.path.join(temp_dir, "batch.json")
+    with open(batch_file, "w") as f:
+        json.dump(batch, f)
+    depfile = os.path.join(temp_dir, "batch.d")
+
+    res = subprocess.run(
+        [
+            sys.executable,
+            "scripts/generate_protocol.py",
+            "--batch",
+            batch_file,
+            "--jobs",
+            "2",
+            "--depfile",
+            depfile,
+            "--template",
+            "scripts/protocol.j2",
+            "--compiler",
+            compiler,
+        ],
+        capture_output=True,
+        text=True,
+    )
+    assert res.returncode == 0, res.stderr
+
+    # Each output matches the header generated on its own.
+    for entry in batch:
+        single_output = os.path.join(temp_dir, "single.h")
+        res = run_generate_protocol(
+            entry["input"],
+            single_output,
+            entry["class_name"],
+            entry["header"],
+            extra_args=["--unique"] if entry["unique"] else None,
+            compiler=compiler,
+        )
+        assert res.returncode == 0, res.stderr
+        with open(entry["output"]) as f, open(single_output) as g:
+            assert f.read() == g.read()
+
+    with open(depfile) as f:
+        rules = f.read()
+    for entry in batch:
+        assert f"{entry['output']}:" in rules
+        assert entry["input"] in rules
+
+
+def test_whitespace_formatter(temp_dir: str, compiler: str) -> None:
+    """Test that --formatter whitespace only changes the layout of the output."""
+    input_header = os.path.join(temp_dir, "input.h")
+    with open(input_header, "w") as f:
+        f.write("class Simple {\npublic:\n  int get() const;\n};\n")
+
+    outputs = {}
+    for formatter in ("clang-format", "whitespace"):
+        output_header = os.path.join(temp_dir, f"{formatter}.h")
+        res = run_generate_protocol(
+            input_header,
+            output_header,
+            "Simple",
+            "input.h",
+            extra_args=["--formatter", formatter],
+            compiler=compiler,
+        )
+        assert res.returncode == 0, res.stderr
+        with open(output_header) as f:
+            outputs[formatter] = f.read()
+
+    tidy = outputs["whitespace"]
+    assert "".join(tidy.split()) == "".join(outputs["clang-format"].split())
+    assert tidy.endswith("\n") and not tidy.endswith("\n\n")
+    assert "\n\n\n" not in tidy
+    assert all(line == line.rstrip() for line in tidy.splitlines())
+
+
+def test_batch_reports_failures(temp_dir: str, compiler: str) -> None:
+    """Test that a batch fails when one of its protocols cannot be generated."""
+    input_header = os.path.join(temp_dir, "input.h")
+    with open(input_header, "w") as f:
+        f.write("class Simple {\npublic:\n  int get() const;\n};\n")
+    batch_file = os.path.join(temp_dir, "batch.json")
+    with open(batch_file, "w") as f:
+        json.dump(
+            [
+                {
+                    "input": input_header,
+                    "output": os.path.join(temp_dir, f"protocol_{name}.h"),
+                    "class_name": name,
+                    "header": "input.h",
+                }
+                for name in ("Simple", "Missing")
+            ],
+            f,
+        )
+
+    res = subprocess.run(
+        [
+            sys.executable,
+            "scripts/generate_protocol.py",
+            "--batch",
+            batch_file,
+            "--template",
+            "scripts/protocol.j2",
+            "--compiler",
+            compiler,
+        ],
+        capture_output=True,
+        text=True,
+    )
+    assert res.returncode != 0
+    assert "Class Missing not found" in res.stderr
+
+
+def test_batch_preamble_does_not_leak_includes(temp_dir: str, compiler: str) -> None:
+    """Test that an interface missing an include fails in a batch too."""
+    interfaces = {
+        "First": "#include <string>\nstruct First {\n  std::string a() const;\n};\n",
+        "Second": "#include <string>\nstruct Second {\n  std::string b() const;\n};\n",
+        "Forgetful": "struct Forgetful {\n  std::string c() const;\n};\n",
+    }
+    batch = []
+    for class_name, source in interfaces.items():
+        input_header = os.path.join(temp_dir, f"{class_name}.h")
+        with open(input_header, "w") as f:
+            f.write(source)
+        batch.append(
+            {
+                "input": input_header,
+                "output": os.path.join(temp_dir, f"protocol_{class_name}.h"),
+                "class_name": class_name,
+                "header": f"{class_name}.h",
+            }
+        )
+    batch_file = os.path.join(temp_dir, "batch.json")
+    with open(batch_file, "w") as f:
+        json.dump(batch, f)
+
+    res = subprocess.run(
+        [
+            sys.executable,
+            "scripts/generate_protocol.py",
+            "--batch",
+            batch_file,
+            "--template",
+            "scripts/protocol.j2",
+            "--compiler",
+            compiler,
+        ],
+        capture_output=True,
+        text=True,
+    )
+    assert res.returncode != 0
+    assert "Forgetful.h" in res.stderr
+    # The interfaces that include what they use are still generated.
+    assert os.path.exists(os.path.join(temp_dir, "protocol_First.h"))
+    assert os.path.exists(os.path.join(temp_dir, "protocol_Second.h"))
+
+
+def test_preambles_follow_include_sets(temp_dir: str, compiler: str) -> None:
+    """Test that only interfaces with the same system includes share a preamble."""
+    sources = {
+        "a.h": "#include <string>\n#include <vector>\n",
+        "b.h": "#include <string>\n#include <vector>\n",
+        "c.h": "#include <vector>\n#include <string>\n",
+        "d.h": "#include <string>\n",
+        "e.h": "",
+        "f.h": "",
+    }
+    paths = {}
+    for name, source in sources.items():
+        paths[name] = os.path.join(temp_dir, name)
+        with open(paths[name], "w") as f:
+            f.write(source)
+
+    preambles = build_preambles(
+        list(paths.values()), get_compiler_args(compiler), temp_dir
+    )
+
+    assert preambles[paths["a.h"]] is not None
+    assert preambles[paths["a.h"]] == preambles[paths["b.h"]]
+    # A different order, a different set, or no system includes get none.
+    for name in ("c.h", "d.h", "e.h", "f.h"):
+        assert preambles[paths[name]] is None
+
+
 def test_mangle_operators(temp_dir: str, compiler: str) -> None:
     """Test that C++ operators are correctly mangled in the generated code."""
     input_header = os.path.join(temp_dir, "input.h")
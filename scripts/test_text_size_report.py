@@ -0,0 +1,77 @@
+"""Tests for the text-size report script."""
+
+from scripts.text_size_report import INTERFACE_CODE
+from scripts.text_size_report import SHARED
+from scripts.text_size_report import classify
+from scripts.text_size_report import summarize
+from scripts.text_size_report import template_arguments
+
+
+def test_template_arguments() -> None:
+    """Test that only top-level template arguments are split."""
+    name = "xyz::protocol<xyz::A, std::allocator<xyz::A> >::vtable_impl<X>"
+    arguments, end = template_arguments(name, name.index("<"))
+    assert arguments == ["xyz::A", "std::allocator<xyz::A>"]
+    assert name[end:] == "::vtable_impl<X>"
+
+    name = "f<(anonymous namespace)::Plugin<3ul>, int>"
+    arguments, _ = template_arguments(name, name.index("<"))
+    assert arguments == ["(anonymous namespace)::Plugin<3ul>", "int"]
+
+
+def test_classify() -> None:
+    """Test that symbols are attributed to their protocol and concrete type."""
+    assert classify(
+        "xyz::protocol<xyz::A, std::allocator<xyz::A> >::vtable_impl<"
+        "(anonymous namespace)::ALike>::xyz_protocol_clone(void*, "
+        "std::allocator<xyz::A> const&)"
+    ) == ("A", "(anonymous namespace)::ALike")
+    assert classify(
+        "xyz::view_vtable_A_Subset_for<Foo>::{lambda(void*)#1}::_FUN(void*)"
+    ) == ("A_Subset", "Foo")
+    assert classify(
+        "xyz::const_view_vtable_G_lookup<Foo>(void const*, unsigned long)"
+    ) == ("G", "Foo")
+    assert classify(
+        "xyz::view_vtable_I_trampolines<Foo>::push_22ae69a8(void*, int)"
+    ) == ("I", "Foo")
+    assert classify(
+        "xyz::protocol_lifetime<Foo, std::allocator<std::byte> >::move(void*, "
+        "std::allocator<std::byte> const&)"
+    ) == (SHARED, "Foo")
+    assert classify(
+        "xyz::protocol_trivial_lifetime<4ul, 4ul>::clone(void*, "
+        "std::allocator<std::byte> const&)"
+    ) == (SHARED, "(trivial, 4 bytes, align 4)")
+    assert classify(
+        "xyz::protocol_view<xyz::A const>::protocol_view(xyz::A&)"
+    ) == ("A", INTERFACE_CODE)
+    assert (
+        classify(
+            "std::vector<xyz::protocol<xyz::A, std::allocator<xyz::A> >, "
+            "std::allocator<xyz::protocol<xyz::A, std::allocator<xyz::A> > > "
+            ">::~vector()"
+        )
+        is None
+    )
+    assert classify("main") is None
+
+
+def test_summarize() -> None:
+    """Test that only sized text symbols are summed."""
+    nm_output = "\n".join(
+        [
+            "0000000000001000 0000000000000010 W xyz::view_vtable_A_for<Foo>::"
+            "{lambda(void*)#1}::_FUN(void*)",
+            "0000000000001010 0000000000000020 t xyz::protocol<xyz::A, "
+            "std::allocator<xyz::A> >::vtable_impl<Foo>::xyz_protocol_move"
+            "(void*, std::allocator<xyz::A> const&)",
+            "0000000000002000 0000000000000100 V xyz::view_vtable_A_for<Foo>",
+            "0000000000001030 0000000000000008 T main",
+            "0000000000001040 t no_size",
+        ]
+    )
+    by_protocol, by_type, total = summarize(nm_output)
+    assert by_protocol == {"A": 0x30}
+    assert by_type == {"Foo": 0x30}
+    assert total == 0x30
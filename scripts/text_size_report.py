@@ -0,0 +1,186 @@
+"""Report the `.text` bytes that generated protocols contribute to a binary."""
+
+import argparse
+import collections
+import re
+import subprocess
+import sys
+from typing import Dict
+from typing import Iterable
+from typing import List
+from typing import Optional
+from typing import Tuple
+
+# Code shared between interfaces, such as the lifetime entries generated with
+# --optimize-size, is attributed to this protocol.
+SHARED = "(shared)"
+
+# Members of a protocol class that do not depend on a concrete type.
+INTERFACE_CODE = "(interface code)"
+
+# Patterns match at the start of the qualified name, so that containers of
+# protocols are not counted as protocol code.
+_CLASS_PATTERN = re.compile(
+    r"(?:^| )xyz::(protocol|unique_protocol|protocol_view|compact_protocol|"
+    r"compact_protocol_view|memoized_protocol)<"
+)
+_VTABLE_PATTERN = re.compile(
+    r"(?:^| )xyz::(?:const_)?view_vtable_(\w+)_(?:for|lookup|trampolines)<"
+)
+_LIFETIME_PATTERN = re.compile(r"(?:^| )xyz::protocol_lifetime<")
+_TRIVIAL_LIFETIME_PATTERN = re.compile(r"(?:^| )xyz::protocol_trivial_lifetime<")
+_VTABLE_IMPL = "::vtable_impl<"
+_TEXT_TYPES = frozenset("tTwW")
+
+
+def template_arguments(name: str, start: int) -> Tuple[List[str], int]:
+    """
+    Split the template argument list that opens at name[start].
+
+    Returns the top-level arguments and the index just past the closing '>'.
+    """
+    assert name[start] == "<"
+    depth = 0
+    arguments = []
+    current = start + 1
+    for i in range(start, len(name)):
+        c = name[i]
+        if c in "<(":
+            depth += 1
+        elif c in ">)":
+            depth -= 1
+            if depth == 0:
+                arguments.append(name[current:i].strip())
+                return arguments, i + 1
+        elif c == "," and depth == 1:
+            arguments.append(name[current:i].strip())
+            current = i + 1
+    return arguments, len(name)
+
+
+def unqualified(type_name: str) -> str:
+    """Strip cv-qualifiers and the namespace of an interface name."""
+    type_name = type_name.removeprefix("const ").removesuffix(" const")
+    return type_name.rsplit("::", 1)[-1]
+
+
+def classify(symbol: str) -> Optional[Tuple[str, str]]:
+    """
+    Return the (protocol, concrete type) of a demangled symbol.
+
+    Symbols that do not belong to generated protocol code return None.
+    """
+    match = _TRIVIAL_LIFETIME_PATTERN.search(symbol)
+    if match:
+        arguments, _ = template_arguments(symbol, match.end() - 1)
+        size, align = (argument.rstrip("ul") for argument in arguments)
+        return SHARED, f"(trivial, {size} bytes, align {align})"
+
+    match = _LIFETIME_PATTERN.search(symbol)
+    if match:
+        arguments, _ = template_arguments(symbol, match.end() - 1)
+        return SHARED, arguments[0]
+
+    match = _VTABLE_PATTERN.search(symbol)
+    if match:
+        arguments, _ = template_arguments(symbol, match.end() - 1)
+        return match.group(1), arguments[0]
+
+    match = _CLASS_PATTERN.search(symbol)
+    if match:
+        arguments, end = template_arguments(symbol, match.end() - 1)
+        protocol = unqualified(arguments[0])
+        if symbol.startswith(_VTABLE_IMPL, end):
+            impl_arguments, _ = template_arguments(
+                symbol, end + len(_VTABLE_IMPL) - 1
+            )
+            return protocol, impl_arguments[0]
+        return protocol, INTERFACE_CODE
+
+    return None
+
+
+def text_symbols(nm_output: str) -> Iterable[Tuple[int, str]]:
+    """Yield (size, demangled name) for each sized text symbol in nm output."""
+    for line in nm_output.splitlines():
+        fields = line.split(maxsplit=3)
+        if len(fields) != 4 or fields[2] not in _TEXT_TYPES:
+            continue
+        try:
+            size = int(fields[1], 16)
+        except ValueError:
+            continue
+        yield size, fields[3]
+
+
+def summarize(
+    nm_output: str,
+) -> Tuple[Dict[str, int], Dict[str, int], int]:
+    """Sum text bytes by protocol and by concrete type, plus the total."""
+    by_protocol: Dict[str, int] = collections.Counter()
+    by_type: Dict[str, int] = collections.Counter()
+    total = 0
+    for size, name in text_symbols(nm_output):
+        owner = classify(name)
+        if owner is None:
+            continue
+        protocol, concrete_type = owner
+        by_protocol[protocol] += size
+        by_type[concrete_type] += size
+        total += size
+    return by_protocol, by_type, total
+
+
+def format_table(title: str, rows: Dict[str, int], limit: int) -> str:
+    """Format rows as a table sorted by descending size."""
+    ordered = sorted(rows.items(), key=lambda item: (-item[1], item[0]))
+    lines = [f"  {title}"]
+    for name, size in ordered[:limit]:
+        lines.append(f"    {size:>10}  {name}")
+    if len(ordered) > limit:
+        rest = sum(size for _, size in ordered[limit:])
+        lines.append(f"    {rest:>10}  ({len(ordered) - limit} more)")
+    return "\n".join(lines)
+
+
+def report(binary: str, nm_output: str, limit: int) -> str:
+    """Format the report for one binary."""
+    by_protocol, by_type, total = summarize(nm_output)
+    return "\n".join(
+        [
+            f"{binary}: {total} bytes of protocol code",
+            format_table("bytes per protocol", by_protocol, limit),
+            format_table("bytes per concrete type", by_type, limit),
+        ]
+    )
+
+
+def main() -> None:
+    """Print a text-size report for each binary given on the command line."""
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("binaries", nargs="+", help="Executables or libraries")
+    parser.add_argument("--nm", default="nm", help="The nm executable to use")
+    parser.add_argument(
+        "--limit",
+        type=int,
+        default=20,
+        help="Rows to print per table; the rest are summed",
+    )
+    args = parser.parse_args()
+
+    reports = []
+    for binary in args.binaries:
+        result = subprocess.run(
+            [args.nm, "--print-size", "--demangle", "--defined-only", binary],
+            capture_output=True,
+            text=True,
+        )
+        if result.returncode != 0:
+            print(result.stderr, file=sys.stderr)
+            sys.exit(result.returncode)
+        reports.append(report(binary, result.stdout, args.limit))
+    print("\n\n".join(reports))
+
+
+if __name__ == "__main__":
+    main()